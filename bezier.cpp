@@ -0,0 +1,373 @@
+#include "bezier.h"
+#include "frustum.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+namespace
+{
+    template<class T>
+    T quick_power(T x, int y) {
+        if (y == 0) { return (T)1; }
+        if (y == 1) { return x; }
+
+        if (y & 1) {
+            return quick_power(x, y-1) * x;
+        }
+
+        T val = quick_power(x, y >> 1);
+        return val * val;
+    }
+
+    int binomialCoeff(int i, int n)
+    {
+        long long x = 1, y = 1;
+        for (int k = 1; k <= i; ++k)
+        {
+            x *= k + n - i;
+            y *= k;
+        }
+        return x / y;
+    }
+}
+
+float Bfunction(float t, int n, int i)
+{
+    return binomialCoeff(i, n) * quick_power(t, i) * quick_power(1.f - t, n - i);
+}
+
+float Zfunction(float x, float y, const float *points)
+{
+    float result = 0;
+    for (int i = 0; i <= BEZIER_N; ++i)
+    {
+        for (int j = 0; j <= BEZIER_M; ++j)
+        {
+            float pt = points[j * (BEZIER_N+1) + i];
+            result += pt * Bfunction(x, BEZIER_N, i) * Bfunction(y, BEZIER_M, j);
+        }
+    }
+    return result;
+}
+
+glm::vec3 Pfunc(float u, float v, const float *points)
+{
+    return glm::vec3(u, v, Zfunction(u, v, points));
+}
+
+glm::vec3 PuFunc(float u, float v, const float *points)
+{
+    glm::vec3 result(0.f, 0.f, 0.f);
+    for (int i = 0; i <= BEZIER_N - 1; ++i)
+    {
+        for (int j = 0; j <= BEZIER_M; ++j)
+        {
+            glm::vec3 Vi1j0{(float)(i + 1) / BEZIER_N, 0, points[(j + 0) * (BEZIER_N+1) + i + 1]};
+            glm::vec3 Vi0j0{(float)(i)     / BEZIER_N, 0, points[(j + 0) * (BEZIER_N+1) + i + 0]};
+            result += (Vi1j0 - Vi0j0) * Bfunction(u, BEZIER_N - 1, i) * Bfunction(v, BEZIER_M, j);
+        }
+    }
+    return (float)BEZIER_N * result;
+}
+
+glm::vec3 PvFunc(float u, float v, const float *points)
+{
+    glm::vec3 result(0.f, 0.f, 0.f);
+    for (int i = 0; i <= BEZIER_N; ++i)
+    {
+        for (int j = 0; j <= BEZIER_M - 1; ++j)
+        {
+            glm::vec3 Vi0j1{0, (float)(j + 1) / BEZIER_M, points[(j + 1) * (BEZIER_N+1) + i + 0]};
+            glm::vec3 Vi0j0{0, (float)(j)     / BEZIER_M, points[(j + 0) * (BEZIER_N+1) + i + 0]};
+            result += (Vi0j1 - Vi0j0) * Bfunction(u, BEZIER_N, i) * Bfunction(v, BEZIER_M - 1, j);
+        }
+    }
+    return (float)BEZIER_M * result;
+}
+
+glm::vec3 NVec(float u, float v, const float *points)
+{
+    return glm::cross(PuFunc(u, v, points), PvFunc(u, v, points));
+}
+
+namespace
+{
+    // points per parallel block of grid rows
+    const int ROW_BLOCK_POINTS = 16384;
+
+    // basis[k * samples + s] = B_k^n(t_s) and deriv[...] its derivative
+    // n (B_{k-1}^{n-1} - B_k^{n-1}), for t_s evenly spaced over [0, 1]
+    void tabulate(int samples, int degree, std::vector<float> &basis, std::vector<float> &deriv)
+    {
+        basis.resize((degree + 1) * samples);
+        deriv.resize((degree + 1) * samples);
+
+        for (int s = 0; s < samples; ++s)
+        {
+            const float t = samples > 1 ? (float)s / (samples - 1) : 0.f;
+            for (int k = 0; k <= degree; ++k)
+            {
+                const float lower = k > 0 ? Bfunction(t, degree - 1, k - 1) : 0.f;
+                const float upper = k < degree ? Bfunction(t, degree - 1, k) : 0.f;
+                basis[k * samples + s] = Bfunction(t, degree, k);
+                deriv[k * samples + s] = degree * (lower - upper);
+            }
+        }
+    }
+}
+
+BezierGrid::BezierGrid(int uPoints, int vPoints)
+    : uCount(uPoints), vCount(vPoints)
+{
+    tabulate(uCount, BEZIER_N, basisU, derivU);
+    tabulate(vCount, BEZIER_M, basisV, derivV);
+    rows.resize((BEZIER_M + 1) * uCount);
+    rowsDu.resize((BEZIER_M + 1) * uCount);
+}
+
+void BezierGrid::evaluate(const float *heights, glm::vec3 *points, glm::vec3 *normals)
+{
+    evaluateControlRows(heights);
+    evaluateGridRows(0, vCount, points, normals);
+}
+
+void BezierGrid::evaluate(const float *heights, glm::vec3 *points, glm::vec3 *normals, ThreadPool &pool)
+{
+    evaluateControlRows(heights);
+
+    const std::size_t grain = std::max(1, ROW_BLOCK_POINTS / uCount);
+    pool.parallelFor(vCount, grain, [this, points, normals](std::size_t begin, std::size_t end)
+    {
+        evaluateGridRows((int)begin, (int)end, points, normals);
+    });
+}
+
+void BezierGrid::evaluateControlRows(const float *heights)
+{
+    // every control row as a curve along u: (M+1) x (N+1) heights times the
+    // (N+1) x uPoints basis table
+    std::fill(rows.begin(), rows.end(), 0.f);
+    std::fill(rowsDu.begin(), rowsDu.end(), 0.f);
+    for (int j = 0; j <= BEZIER_M; ++j)
+    {
+        float *row = &rows[j * uCount];
+        float *rowDu = &rowsDu[j * uCount];
+        for (int i = 0; i <= BEZIER_N; ++i)
+        {
+            const float height = heights[j * (BEZIER_N+1) + i];
+            const float *basis = &basisU[i * uCount];
+            const float *deriv = &derivU[i * uCount];
+            for (int s = 0; s < uCount; ++s)
+            {
+                row[s] += basis[s] * height;
+                rowDu[s] += deriv[s] * height;
+            }
+        }
+    }
+}
+
+void BezierGrid::evaluateGridRows(int begin, int end, glm::vec3 *points, glm::vec3 *normals) const
+{
+    // blend the row curves with the v basis of each grid row
+    for (int t = begin; t < end; ++t)
+    {
+        float bv[BEZIER_M + 1], dv[BEZIER_M + 1];
+        for (int j = 0; j <= BEZIER_M; ++j)
+        {
+            bv[j] = basisV[j * vCount + t];
+            dv[j] = derivV[j * vCount + t];
+        }
+
+        const float v = vCount > 1 ? (float)t / (vCount - 1) : 0.f;
+        glm::vec3 *rowPoints = points + t * uCount;
+        glm::vec3 *rowNormals = normals + t * uCount;
+
+        for (int s = 0; s < uCount; ++s)
+        {
+            float z = 0.f, dzdu = 0.f, dzdv = 0.f;
+            for (int j = 0; j <= BEZIER_M; ++j)
+            {
+                z += bv[j] * rows[j * uCount + s];
+                dzdu += bv[j] * rowsDu[j * uCount + s];
+                dzdv += dv[j] * rows[j * uCount + s];
+            }
+
+            // Pu = (1, 0, dz/du) and Pv = (0, 1, dz/dv), as in PuFunc/PvFunc
+            const float u = uCount > 1 ? (float)s / (uCount - 1) : 0.f;
+            rowPoints[s] = glm::vec3(u, v, z);
+            rowNormals[s] = glm::normalize(glm::vec3(-dzdu, -dzdv, 1.f));
+        }
+    }
+}
+
+void BezierTiles::select(const float *heights, const glm::mat4 &model, const glm::mat4 &view,
+                         const glm::mat4 &projection, float viewportHeight, float maxPixelError)
+{
+    // bounds of the second derivatives from the differences of the control
+    // net; the surface lies within the range of the control heights
+    auto height = [heights](int i, int j) { return heights[j * (BEZIER_N+1) + i]; };
+
+    float zuu = 0.f, zvv = 0.f, zuv = 0.f;
+    float zmin = heights[0], zmax = heights[0];
+    for (int j = 0; j <= BEZIER_M; ++j)
+    {
+        for (int i = 0; i <= BEZIER_N; ++i)
+        {
+            zmin = std::min(zmin, height(i, j));
+            zmax = std::max(zmax, height(i, j));
+            if (i + 2 <= BEZIER_N)
+                zuu = std::max(zuu, std::abs(height(i + 2, j) - 2.f * height(i + 1, j) + height(i, j)));
+            if (j + 2 <= BEZIER_M)
+                zvv = std::max(zvv, std::abs(height(i, j + 2) - 2.f * height(i, j + 1) + height(i, j)));
+            if (i + 1 <= BEZIER_N && j + 1 <= BEZIER_M)
+                zuv = std::max(zuv, std::abs(height(i + 1, j + 1) - height(i + 1, j) - height(i, j + 1) + height(i, j)));
+        }
+    }
+    zuu *= BEZIER_N * (BEZIER_N - 1);
+    zvv *= BEZIER_M * (BEZIER_M - 1);
+    zuv *= BEZIER_N * BEZIER_M;
+
+    // a lattice triangle of spacing h is off the surface by at most
+    // h^2 / 8 * (|zuu| + 2|zuv| + |zvv|), along object z
+    const float curvature = (zuu + 2.f * zuv + zvv) / 8.f * glm::length(glm::vec3(model[2]));
+    const float pixelsPerUnit = projection[1][1] * viewportHeight * 0.5f; // at distance 1
+
+    const Frustum frustum = Frustum::fromMatrix(projection * view * model);
+    const glm::mat4 viewModel = view * model;
+    const float size = 1.f / TILES_PER_SIDE;
+
+    for (int ty = 0; ty < TILES_PER_SIDE; ++ty)
+    {
+        for (int tx = 0; tx < TILES_PER_SIDE; ++tx)
+        {
+            int &level = levels[ty * TILES_PER_SIDE + tx];
+
+            const glm::vec3 boundsMin(tx * size, ty * size, zmin);
+            const glm::vec3 boundsMax((tx + 1) * size, (ty + 1) * size, zmax);
+            if (!frustum.intersects(boundsMin, boundsMax))
+            {
+                level = -1;
+                continue;
+            }
+
+            // nearest distance to the tile's bounding sphere
+            const glm::vec3 center(viewModel * glm::vec4((boundsMin + boundsMax) * 0.5f, 1.f));
+            const float radius = 0.5f * glm::length(glm::vec3(viewModel * glm::vec4(boundsMax - boundsMin, 0.f)));
+            const float distance = std::max(glm::length(center) - radius, 1e-3f);
+
+            // the coarsest spacing whose projected error is within the threshold
+            level = 0;
+            if (curvature > 0.f)
+            {
+                const float spacing = std::sqrt(maxPixelError * distance / (pixelsPerUnit * curvature));
+                level = (int)std::ceil(std::log2(size / spacing));
+                level = std::max(0, std::min(MAX_LEVEL, level));
+            }
+        }
+    }
+
+    for (std::vector<Instance> &instances : levelInstances)
+        instances.clear();
+
+    for (int ty = 0; ty < TILES_PER_SIDE; ++ty)
+    {
+        for (int tx = 0; tx < TILES_PER_SIDE; ++tx)
+        {
+            const int level = levels[ty * TILES_PER_SIDE + tx];
+            if (level < 0)
+                continue;
+
+            // snap to a coarser visible neighbour's lattice; culled and
+            // missing neighbours need no match
+            auto edgeStep = [this, level](int x, int y)
+            {
+                if (x < 0 || y < 0 || x >= TILES_PER_SIDE || y >= TILES_PER_SIDE)
+                    return 1.f;
+                const int neighbour = levels[y * TILES_PER_SIDE + x];
+                return neighbour >= 0 && neighbour < level ? (float)(1 << (level - neighbour)) : 1.f;
+            };
+
+            Instance instance;
+            instance.tile = glm::vec4((float)tx, (float)ty, (float)(1 << level), size);
+            instance.edges = glm::vec4(edgeStep(tx - 1, ty), edgeStep(tx + 1, ty),
+                                       edgeStep(tx, ty - 1), edgeStep(tx, ty + 1));
+            levelInstances[level].push_back(instance);
+        }
+    }
+}
+
+std::size_t BezierTiles::quadCount() const
+{
+    std::size_t quads = 0;
+    for (int level = 0; level <= MAX_LEVEL; ++level)
+        quads += levelInstances[level].size() << (2 * level);
+    return quads;
+}
+
+int benchBezier()
+{
+    float heights[(BEZIER_N+1) * (BEZIER_M+1)];
+    for (float &height : heights)
+        height = (float)std::rand() / RAND_MAX;
+
+    const int resolutions[] = {50, 256, 1024};
+    for (int resolution : resolutions)
+    {
+        const std::size_t count = (std::size_t)resolution * resolution;
+        std::vector<glm::vec3> points(count), normals(count);
+        std::vector<glm::vec3> referencePoints(count), referenceNormals(count);
+
+        // enough repetitions for a stable figure at the small sizes
+        const int repetitions = std::max(1, (int)(1000000 / count));
+
+        using Clock = std::chrono::steady_clock;
+        Clock::time_point start = Clock::now();
+        for (int r = 0; r < repetitions; ++r)
+        {
+            for (int j = 0; j < resolution; ++j)
+            {
+                for (int i = 0; i < resolution; ++i)
+                {
+                    const float u = (float)i / (resolution - 1);
+                    const float v = (float)j / (resolution - 1);
+                    referencePoints[j * resolution + i] = Pfunc(u, v, heights);
+                    referenceNormals[j * resolution + i] = glm::normalize(NVec(u, v, heights));
+                }
+            }
+        }
+        const double referenceMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / repetitions;
+
+        start = Clock::now();
+        BezierGrid grid(resolution, resolution);
+        const double tablesMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        start = Clock::now();
+        for (int r = 0; r < repetitions; ++r)
+            grid.evaluate(heights, points.data(), normals.data());
+        const double gridMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / repetitions;
+
+        ThreadPool &pool = ThreadPool::shared();
+        start = Clock::now();
+        for (int r = 0; r < repetitions; ++r)
+            grid.evaluate(heights, points.data(), normals.data(), pool);
+        const double poolMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / repetitions;
+
+        float maxError = 0.f;
+        for (std::size_t k = 0; k < count; ++k)
+        {
+            maxError = std::max(maxError, glm::length(points[k] - referencePoints[k]));
+            maxError = std::max(maxError, glm::length(normals[k] - referenceNormals[k]));
+        }
+
+        std::cout << "[Bezier] " << resolution << 'x' << resolution
+                  << ": reference " << referenceMs << " ms"
+                  << ", tables " << gridMs << " ms (" << referenceMs / gridMs << "x, built in " << tablesMs << " ms)"
+                  << ", tables on " << pool.size() + 1 << " threads " << poolMs << " ms (" << gridMs / poolMs << "x)"
+                  << ", max error " << maxError << '\n';
+    }
+    return 0;
+}
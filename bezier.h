@@ -0,0 +1,101 @@
+#ifndef BEZIER_H
+#define BEZIER_H
+#include <vector>
+#include <glm/glm.hpp>
+
+class ThreadPool;
+
+// Degree of the animated surface along u and v. The control heights are
+// stored row by row: heights[j * (BEZIER_N+1) + i], i along u, j along v.
+const int BEZIER_N = 3;
+const int BEZIER_M = 3;
+
+// Direct evaluation over the unit square, recomputing the Bernstein basis
+// for every sample; kept as the reference for BezierGrid.
+float Bfunction(float t, int n, int i);
+float Zfunction(float x, float y, const float *points);
+glm::vec3 Pfunc(float u, float v, const float *points);
+glm::vec3 PuFunc(float u, float v, const float *points);
+glm::vec3 PvFunc(float u, float v, const float *points);
+
+// not normalized
+glm::vec3 NVec(float u, float v, const float *points);
+
+// The surface sampled on a fixed u x v grid. The basis and derivative-basis
+// values of every grid column and row are tabulated once, so a frame only
+// runs small dense products over the control heights.
+class BezierGrid
+{
+public:
+    BezierGrid(int uPoints, int vPoints);
+
+    int uPoints() const { return uCount; }
+    int vPoints() const { return vCount; }
+
+    // points (u, v, z) and unit normals of every sample, u fastest:
+    // index j * uPoints() + i
+    void evaluate(const float *heights, glm::vec3 *points, glm::vec3 *normals);
+
+    // the same with blocks of grid rows spread over the pool; every block
+    // writes its own range of the outputs
+    void evaluate(const float *heights, glm::vec3 *points, glm::vec3 *normals, ThreadPool &pool);
+
+private:
+    int uCount, vCount;
+
+    // [k * samples + s]: basis function k at sample s, and its derivative
+    std::vector<float> basisU, derivU;
+    std::vector<float> basisV, derivV;
+
+    // scratch: every control row evaluated along u, and its u derivative
+    std::vector<float> rows, rowsDu;
+
+    // fills rows and rowsDu, shared by all grid rows
+    void evaluateControlRows(const float *heights);
+
+    void evaluateGridRows(int begin, int end, glm::vec3 *points, glm::vec3 *normals) const;
+};
+
+// Adaptive tessellation of the surface for the BEZIER_TILES permutation.
+// The unit square is split into TILES_PER_SIDE^2 tiles, each drawn as a
+// lattice of 2^level quads per side. A tile gets the coarsest level whose
+// interpolation error, projected to the screen, stays under a pixel
+// threshold. Where a tile meets a coarser one, its edge vertices snap to
+// the coarser lattice in the vertex shader (bezier_surface.glsl), so
+// neighbouring levels share the same edge and leave no cracks.
+class BezierTiles
+{
+public:
+    static const int TILES_PER_SIDE = 8;
+    static const int MAX_LEVEL = 7; // 128 quads per tile side, 1024 over the surface
+
+    // per-instance vertex data of one tile
+    struct Instance
+    {
+        glm::vec4 tile;  // tile x, tile y, quads per side, 1 / TILES_PER_SIDE
+        glm::vec4 edges; // lattice step on the left, right, bottom and top edge
+    };
+
+    // picks the level of every tile and culls the tiles outside the view;
+    // viewportHeight is in pixels
+    void select(const float *heights, const glm::mat4 &model, const glm::mat4 &view,
+                const glm::mat4 &projection, float viewportHeight, float maxPixelError);
+
+    // the visible tiles drawn at a level
+    const std::vector<Instance> &instances(int level) const { return levelInstances[level]; }
+
+    // quads over all visible tiles
+    std::size_t quadCount() const;
+
+private:
+    static const int TILE_COUNT = TILES_PER_SIDE * TILES_PER_SIDE;
+
+    int levels[TILE_COUNT]; // -1 for culled tiles
+    std::vector<Instance> levelInstances[MAX_LEVEL + 1];
+};
+
+// Times the reference evaluator against BezierGrid, serial and on the
+// shared pool, at a few resolutions.
+int benchBezier();
+
+#endif
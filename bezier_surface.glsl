@@ -0,0 +1,60 @@
+// Bicubic Bezier patch over the unit square, evaluated per vertex for the
+// BEZIER_SURFACE permutation. Only the 16 control heights change per frame;
+// the vertices are a static (u, v) grid, or with BEZIER_TILES the lattice
+// of one tile per instance (BezierTiles). Mirrored by BezierBlock in
+// uniform_blocks.h.
+
+layout (std140) uniform BezierBlock {
+    vec4 controlHeights[4]; // controlHeights[j][i]: i along u, j along v
+};
+
+vec4 bernstein3(float t) {
+    float s = 1.0 - t;
+    return vec4(s * s * s, 3.0 * s * s * t, 3.0 * s * t * t, t * t * t);
+}
+
+vec3 bernstein2(float t) {
+    float s = 1.0 - t;
+    return vec3(s * s, 2.0 * s * t, t * t);
+}
+
+// position (u, v, z(u, v)) and the unnormalized normal Pu x Pv
+void bezier_surface(vec2 uv, out vec3 position, out vec3 normal) {
+    vec4 bu = bernstein3(uv.x);
+    vec4 bv = bernstein3(uv.y);
+    vec3 du = bernstein2(uv.x);
+    vec3 dv = bernstein2(uv.y);
+
+    vec4 rows;    // every v-row evaluated at u
+    vec4 rowsDu;  // and its u derivative
+    for (int j = 0; j < 4; ++j) {
+        rows[j] = dot(bu, controlHeights[j]);
+        rowsDu[j] = 3.0 * dot(du, controlHeights[j].yzw - controlHeights[j].xyz);
+    }
+
+    float dzdu = dot(bv, rowsDu);
+    float dzdv = 3.0 * dot(dv, rows.yzw - rows.xyz);
+
+    position = vec3(uv, dot(bv, rows));
+    normal = vec3(-dzdu, -dzdv, 1.0);
+}
+
+#ifdef BEZIER_TILES
+// uv of a tile lattice vertex. tile: tile x, tile y, quads per side,
+// 1 / tiles per side; edges: lattice step of the left, right, bottom and top
+// neighbour. Edge vertices snap down to a coarser neighbour's lattice, so
+// both tiles evaluate the same edge vertices; the collapsed triangles are
+// degenerate. All terms are exact in float, so shared uvs match bit for bit.
+vec2 bezier_tile_uv(vec2 local, vec4 tile, vec4 edges) {
+    float n = tile.z;
+    if (local.x == 0.0)
+        local.y = floor(local.y / edges.x) * edges.x;
+    else if (local.x == n)
+        local.y = floor(local.y / edges.y) * edges.y;
+    if (local.y == 0.0)
+        local.x = floor(local.x / edges.z) * edges.z;
+    else if (local.y == n)
+        local.x = floor(local.x / edges.w) * edges.w;
+    return (tile.xy + local / n) * tile.w;
+}
+#endif
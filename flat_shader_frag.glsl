@@ -1,20 +1,6 @@
 #version 330 core
 
-#define NR_LIGHTS 4
-#define NR_SPOTLIGHTS 2
-
-struct Light {
-    vec3 ambientLightColor;
-    vec3 diffuseLightColor;
-    vec3 specularLightColor;
-
-    // attenuation
-    float constant;
-    float linear;
-    float quadratic;
-
-    vec3 lightPosView;
-};
+#include "lighting.glsl"
 
 out vec4 FragColor;
 
@@ -23,34 +9,32 @@ in vec3 specular_intensity;
 in vec2 TexCoords;
 in vec3 FragPosView;
 
+#ifdef SOLID_COLOR
+uniform vec3 solidColor; // untextured: replaces the diffuse map, specular is unweighted
+#else
 uniform sampler2D texture_diffuse1;
 uniform sampler2D texture_specular1;
-
-uniform float gamma;
-
-uniform Light lights[NR_LIGHTS];
-
-uniform float fogDensity;
-uniform vec3 fogColor;
+#endif
 
 void main()
 {
-    vec3 ambient = vec3(0.0);
-
-    for (int i = 0; i < NR_LIGHTS; ++i) {
-        ambient = ambient + lights[i].ambientLightColor;
-    }
-
-    ambient *= texture(texture_diffuse1, TexCoords).rgb;
-
-    vec3 diffuse = diffuse_intensity * texture(texture_diffuse1, TexCoords).rgb;
-    vec3 specular = specular_intensity * texture(texture_specular1, TexCoords).rgb;
-
-    vec3 color = ambient + diffuse + specular;
-
-    float factor = length(FragPosView) * fogDensity;
-    float alpha = 1.0 / exp(factor * factor);
-    color = mix(fogColor, color, alpha);
+#ifdef SOLID_COLOR
+    vec3 diffuseColor = solidColor;
+    vec3 specularColor = vec3(1.0);
+#else
+    vec3 diffuseColor = texture(texture_diffuse1, TexCoords).rgb;
+    vec3 specularColor = texture(texture_specular1, TexCoords).rgb;
+#endif
+
+    vec3 ambient = ambient_lighting() * diffuseColor;
+    vec3 diffuse = diffuse_intensity * diffuseColor;
+
+    vec3 color = ambient + diffuse;
+#ifdef SPECULAR_MAP
+    color += specular_intensity * specularColor;
+#endif
+
+    color = apply_fog(color, FragPosView);
 
     color = pow(color, vec3(1.0 / gamma));
     FragColor = vec4(color, 1.0);
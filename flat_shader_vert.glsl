@@ -2,6 +2,16 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
+#ifdef BEZIER_TILES
+layout (location = 3) in vec4 aTile;      // per instance, see bezier_tile_uv
+layout (location = 4) in vec4 aTileEdges;
+#endif
+
+#include "uniform_blocks.glsl"
+
+#ifdef BEZIER_SURFACE
+#include "bezier_surface.glsl"
+#endif
 
 out VS_OUT {
     vec2 texCoords;
@@ -9,15 +19,21 @@ out VS_OUT {
     vec3 normal;      // view
 } vs_out;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-uniform mat3 normViewModelMatrix;
-
 void main()
 {
-    vs_out.normal = normViewModelMatrix * aNormal;
-    vs_out.position = view * model *  vec4(aPos, 1.0);
+#ifdef BEZIER_SURFACE
+    vec3 position, normal;
+#ifdef BEZIER_TILES
+    bezier_surface(bezier_tile_uv(aPos.xy, aTile, aTileEdges), position, normal);
+#else
+    bezier_surface(aPos.xy, position, normal);
+#endif
+#else
+    vec3 position = aPos;
+    vec3 normal = aNormal;
+#endif
+    vs_out.normal = normViewModelMatrix * normal;
+    vs_out.position = view * model *  vec4(position, 1.0);
     gl_Position = projection * vs_out.position;
     vs_out.texCoords = aTexCoords;
 }
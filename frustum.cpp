@@ -0,0 +1,32 @@
+#include "frustum.h"
+
+Frustum Frustum::fromMatrix(const glm::mat4 &clip)
+{
+    // rows of the matrix; glm stores columns
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; ++i)
+        rows[i] = glm::vec4(clip[0][i], clip[1][i], clip[2][i], clip[3][i]);
+
+    Frustum frustum;
+    frustum.planes[0] = rows[3] + rows[0]; // left
+    frustum.planes[1] = rows[3] - rows[0]; // right
+    frustum.planes[2] = rows[3] + rows[1]; // bottom
+    frustum.planes[3] = rows[3] - rows[1]; // top
+    frustum.planes[4] = rows[3] + rows[2]; // near
+    frustum.planes[5] = rows[3] - rows[2]; // far
+    return frustum;
+}
+
+bool Frustum::intersects(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax) const
+{
+    for (const glm::vec4 &plane : planes)
+    {
+        // the corner furthest along the plane normal
+        const glm::vec3 corner(plane.x >= 0.f ? boundsMax.x : boundsMin.x,
+                               plane.y >= 0.f ? boundsMax.y : boundsMin.y,
+                               plane.z >= 0.f ? boundsMax.z : boundsMin.z);
+        if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.f)
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,17 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+#include <glm/glm.hpp>
+
+// The six clip planes of a projection * view * model matrix, in the space
+// that matrix transforms from, so object-space boxes are tested directly.
+struct Frustum
+{
+    glm::vec4 planes[6]; // inside where dot(plane, vec4(p, 1)) >= 0
+
+    static Frustum fromMatrix(const glm::mat4 &clip);
+
+    // false only when the box lies entirely outside one of the planes
+    bool intersects(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax) const;
+};
+
+#endif
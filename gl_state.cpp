@@ -0,0 +1,100 @@
+#include "gl_state.h"
+#include "render_stats.h"
+
+#include <algorithm>
+
+GlState glState;
+
+bool GlState::change(GLuint &current, GLuint value)
+{
+    if (current == value)
+    {
+        renderStats.stateChangesSkipped++;
+        return false;
+    }
+    current = value;
+    renderStats.stateChanges++;
+    return true;
+}
+
+bool GlState::change(int &current, bool value)
+{
+    if (current == static_cast<int>(value))
+    {
+        renderStats.stateChangesSkipped++;
+        return false;
+    }
+    current = value;
+    renderStats.stateChanges++;
+    return true;
+}
+
+void GlState::useProgram(GLuint program)
+{
+    if (change(currentProgram, program))
+        glUseProgram(program);
+}
+
+void GlState::bindVertexArray(GLuint vao)
+{
+    if (change(currentVertexArray, vao))
+        glBindVertexArray(vao);
+}
+
+void GlState::activeTexture(GLuint unit)
+{
+    if (change(currentUnit, unit))
+        glActiveTexture(GL_TEXTURE0 + unit);
+}
+
+void GlState::bindTexture(GLuint unit, GLenum target, GLuint texture)
+{
+    if (unit >= MAX_TEXTURE_UNITS)
+    {
+        currentUnit = unit;
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(target, texture);
+        return;
+    }
+
+    GLuint &current = target == GL_TEXTURE_CUBE_MAP ? texturesCube[unit] : textures2D[unit];
+    if (current == texture)
+    {
+        renderStats.stateChangesSkipped++;
+        return;
+    }
+
+    activeTexture(unit);
+    change(current, texture);
+    glBindTexture(target, texture);
+}
+
+void GlState::setDepthTest(bool enabled)
+{
+    if (change(depthTest, enabled))
+        enabled ? glEnable(GL_DEPTH_TEST) : glDisable(GL_DEPTH_TEST);
+}
+
+void GlState::setCullFace(bool enabled)
+{
+    if (change(cullFace, enabled))
+        enabled ? glEnable(GL_CULL_FACE) : glDisable(GL_CULL_FACE);
+}
+
+void GlState::depthFunc(GLenum func)
+{
+    if (change(currentDepthFunc, func))
+        glDepthFunc(func);
+}
+
+void GlState::invalidate()
+{
+    currentProgram = UNKNOWN;
+    currentVertexArray = UNKNOWN;
+    currentUnit = UNKNOWN;
+    std::fill(textures2D, textures2D + MAX_TEXTURE_UNITS, UNKNOWN);
+    std::fill(texturesCube, texturesCube + MAX_TEXTURE_UNITS, UNKNOWN);
+    depthTest = -1;
+    cullFace = -1;
+    currentDepthFunc = UNKNOWN;
+}
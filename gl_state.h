@@ -0,0 +1,45 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+#include <glad/glad.h>
+
+// Shadow of the GL state the renderer changes per draw. Every setter skips
+// the GL call when the value is already current and counts both outcomes in
+// RenderStats. Code that changes this state with raw GL calls (texture
+// uploads, for example) has to call invalidate() afterwards.
+class GlState
+{
+public:
+    static const GLuint MAX_TEXTURE_UNITS = 16;
+
+    GlState() { invalidate(); }
+
+    void useProgram(GLuint program);
+    void bindVertexArray(GLuint vao);
+    void activeTexture(GLuint unit); // unit index, not GL_TEXTURE0 + unit
+    void bindTexture(GLuint unit, GLenum target, GLuint texture); // 2D or cube map
+    void setDepthTest(bool enabled);
+    void setCullFace(bool enabled);
+    void depthFunc(GLenum func);
+
+    // forget everything; the next call of every setter reaches GL
+    void invalidate();
+
+private:
+    static const GLuint UNKNOWN = ~0u;
+
+    GLuint currentProgram;
+    GLuint currentVertexArray;
+    GLuint currentUnit;
+    GLuint textures2D[MAX_TEXTURE_UNITS];
+    GLuint texturesCube[MAX_TEXTURE_UNITS];
+    int depthTest; // -1 unknown, else 0 or 1
+    int cullFace;
+    GLenum currentDepthFunc;
+
+    bool change(GLuint &current, GLuint value);
+    bool change(int &current, bool value);
+};
+
+extern GlState glState;
+
+#endif
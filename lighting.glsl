@@ -0,0 +1,110 @@
+// Lighting shared by the flat, Gouraud and Phong programs. The permutation
+// defines (see ShaderFeatures) fix the loop bounds and remove unused terms
+// at compile time:
+//   POINT_LIGHTS  point lights evaluated, lights[0 .. POINT_LIGHTS)
+//   SPOTLIGHTS    spotlights evaluated, lights[SPOTLIGHT_BASE + i]
+//   NIGHT         the sun (lights[0]) only adds ambient light
+//   SPECULAR_MAP  the object has a specular map; no specular term otherwise
+//   FOG           the object is fogged
+// and the stage files themselves use
+//   BEZIER_SURFACE  the vertex stage evaluates the Bezier patch (bezier_surface.glsl)
+//   BEZIER_TILES    with BEZIER_SURFACE, the vertices are instanced tile lattices
+//   SOLID_COLOR     the fragment stage uses solidColor instead of the material textures
+
+#include "uniform_blocks.glsl"
+
+#define SPOTLIGHT_BASE (NR_LIGHTS - NR_SPOTLIGHTS)
+
+#ifndef POINT_LIGHTS
+#define POINT_LIGHTS SPOTLIGHT_BASE
+#endif
+#ifndef SPOTLIGHTS
+#define SPOTLIGHTS NR_SPOTLIGHTS
+#endif
+
+#ifdef NIGHT
+#define FIRST_POINT_LIGHT 1
+#else
+#define FIRST_POINT_LIGHT 0
+#endif
+
+Light object_light(int i) {
+    Light light = lights[i];
+    if (lightDiffuseOverride[i].a > 0.0)
+        light.diffuseLightColor = lightDiffuseOverride[i].rgb;
+    return light;
+}
+
+float get_attenuation(float dist, Light light) {
+    return 1.0 / (light.constant + light.linear * dist + light.quadratic * (dist * dist));
+}
+
+vec3 calc_diffuse_point_light(Light light, vec3 normal, vec3 fragPosView, vec3 viewDir) {
+    vec3 lightDir   = normalize(light.lightPosView - fragPosView);
+    float diff      = max(dot(normal, lightDir), 0.0);
+    float dist      = length(light.lightPosView - fragPosView);
+    vec3 diffuse    = light.diffuseLightColor * diff;
+    diffuse         = diffuse * get_attenuation(dist, light);
+    return            diffuse;
+}
+
+vec3 calc_specular_point_light(Light light, vec3 normal, vec3 fragPosView, vec3 viewDir) {
+    vec3 lightDir   = normalize(light.lightPosView - fragPosView);
+    vec3 halfwayDir = normalize(lightDir + viewDir);
+    float spec      = pow(max(dot(normal, halfwayDir), 0.0), shininess);
+    float dist      = length(light.lightPosView - fragPosView);
+    vec3 specular   = light.specularLightColor * spec;
+    specular        = specular * get_attenuation(dist, light);
+    return            specular;
+}
+
+vec3 calc_spotlight(vec3 color, SpotlightComponents spotlight, vec3 lightDir) {
+    float theta     = dot(lightDir, normalize(spotlight.spotDirectionView));
+    float epsilon   = spotlight.cutOff - spotlight.outerCutoff;
+    float intensity = clamp((theta - spotlight.outerCutoff) / epsilon, 0.0, 1.0);
+    color           = color * intensity;
+    return            color;
+}
+
+vec3 ambient_lighting() {
+    vec3 ambient = vec3(0.0);
+    for (int i = 0; i < NR_LIGHTS; ++i) {
+        ambient = ambient + lights[i].ambientLightColor;
+    }
+    return ambient;
+}
+
+vec3 diffuse_lighting(vec3 norm, vec3 position, vec3 viewDir) {
+    vec3 result = vec3(0.0);
+    for (int i = FIRST_POINT_LIGHT; i < POINT_LIGHTS; ++i) {
+        result += calc_diffuse_point_light(object_light(i), norm, position, viewDir);
+    }
+    for (int i = 0; i < SPOTLIGHTS; ++i) {
+        result += calc_spotlight(calc_diffuse_point_light(object_light(SPOTLIGHT_BASE + i), norm, position, viewDir),
+                                 spotlightComponents[i], normalize(lights[SPOTLIGHT_BASE + i].lightPosView - position));
+    }
+    return result;
+}
+
+vec3 specular_lighting(vec3 norm, vec3 position, vec3 viewDir) {
+    vec3 result = vec3(0.0);
+#ifdef SPECULAR_MAP
+    for (int i = FIRST_POINT_LIGHT; i < POINT_LIGHTS; ++i) {
+        result += calc_specular_point_light(lights[i], norm, position, viewDir);
+    }
+    for (int i = 0; i < SPOTLIGHTS; ++i) {
+        result += calc_spotlight(calc_specular_point_light(lights[SPOTLIGHT_BASE + i], norm, position, viewDir),
+                                 spotlightComponents[i], normalize(lights[SPOTLIGHT_BASE + i].lightPosView - position));
+    }
+#endif
+    return result;
+}
+
+vec3 apply_fog(vec3 color, vec3 positionView) {
+#ifdef FOG
+    float factor = length(positionView) * fogDensity;
+    float alpha = 1.0 / exp(factor * factor);
+    color = mix(fogColor, color, alpha);
+#endif
+    return color;
+}
@@ -1,31 +1,36 @@
 #include "shader.h"
+#include "shader_variants.h"
+#include "stream_buffer.h"
 #include "model.h"
 #include "mesh.h"
+#include "bezier.h"
 #include "camera.h"
+#include "gl_state.h"
+#include "render_queue.h"
+#include "render_stats.h"
+#include "uniform_blocks.h"
+#include "texture_cook.h"
+#include "texture_loader.h"
+#include "thread_pool.h"
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 
 extern const float skyboxVertices[108];
 
-template<class T>
-T quick_power(T x, int y);
-
-int binomialCoeff(int i, int n);
-float Bfunction(float t, int n, int i);
-float Zfunction(float x, float y, const float *points);
-glm::vec3 Pfunc(float u, float v, const float *points);
-glm::vec3 PuFunc(float u, float v, const float *points);
-glm::vec3 PvFunc(float u, float v, const float *points);
-
-// not normalized
-glm::vec3 NVec(float u, float v, const float *points);
-
 struct GlobalAttributes;
-void updateTriangles(GlobalAttributes& attr);
+void animateControlPoints(const GlobalAttributes& attr, float *heights);
+GLint updateBezierVertices(GlobalAttributes& attr, const float *heights, StreamBuffer& stream);
+void createBezierGrid(GlobalAttributes& attr, StreamBuffer& stream);
+void createBezierTiles(GlobalAttributes& attr, const StreamBuffer& stream);
+void pointBezierTiles(const GlobalAttributes& attr, const StreamBuffer& stream, std::size_t regionOffset);
+bool uploadBezierTiles(GlobalAttributes& attr, StreamBuffer& stream);
 
 void framebuffer_size_callback(GLFWwindow *window, int width, int height);
 void mouse_callback(GLFWwindow *window, double xpos, double ypos);
@@ -48,23 +53,35 @@ enum class CameraMode {
     LookingAt
 };
 
+enum class BezierMode {
+    Adaptive, // GPU-evaluated tiles, each at its own level of detail
+    Uniform,  // GPU-evaluated grid at bezierResolution
+    CPU       // CPU-evaluated grid at bezierResolution, streamed
+};
+
 enum class Shading {
     Flat,
     Gouraud,
     Phong
 };
 
-const int BEZIER_N = 3;
-const int BEZIER_M = 3;
+static_assert(BEZIER_N == 3 && BEZIER_M == 3, "BezierBlock and bezier_surface.glsl hold a bicubic patch");
 
 const int GL_MAJOR = 3;
 const int GL_MINOR = 3;
 
+const float FAR_PLANE = 10000.f;
+
 const unsigned int SCR_WIDTH = 1920;
 const unsigned int SCR_HEIGHT = 1080;
 
-const int u_nr_points = 50;
-const int v_nr_points = 50;
+// grid points along u and v of the Bezier surface
+const int BEZIER_MIN_RESOLUTION = 2;
+const int BEZIER_MAX_RESOLUTION = 1024;
+
+// adaptive tiles: the largest distance, in pixels, between the drawn and the
+// exact surface
+const float BEZIER_MAX_PIXEL_ERROR = 0.5f;
 
 const float moonShininess = 4;
 const float cityShininess = 4;
@@ -76,13 +93,30 @@ struct GlobalAttributes {
     
     GlobalAttributes() : camera(glm::vec3(0.f, 0.f, 3.f)) {}
 
-    unsigned int trVBO, trVAO;
+    // CPU-evaluated surface: every StreamBuffer region holds the positions
+    // then the normals of the grid points, drawn with the grid's index buffer
+    unsigned int trVAO = 0;
+
+    // static (u, v) grid evaluated by the BEZIER_SURFACE vertex stage
+    unsigned int gridVBO = 0, gridEBO = 0, gridVAO = 0;
+    GLsizei gridIndexCount = 0;
+
+    // one lattice mesh per tile level, instanced from a streamed region that
+    // holds a slice of every level's tiles
+    BezierTiles bezierTiles;
+    unsigned int tileVAOs[BezierTiles::MAX_LEVEL + 1];
+    GLsizei tileIndexCounts[BezierTiles::MAX_LEVEL + 1];
+    std::size_t tileRegionOffset = 0; // region the instance attributes point at
 
     float controlPointZs[(BEZIER_N+1) * (BEZIER_M+1)];
     float controlPointPhases[(BEZIER_N+1) * (BEZIER_M+1)];
     float controlPointAmplitudes[(BEZIER_N+1) * (BEZIER_M+1)];
     
-    std::vector<float> triangles;
+    // grid points along u and v; the buffers and tables below follow it
+    int bezierResolution = 50;
+
+    // CPU evaluation: basis tables of the grid
+    BezierGrid bezierGrid{bezierResolution, bezierResolution};
 
     Camera camera;
 
@@ -107,11 +141,16 @@ struct GlobalAttributes {
     CameraMode cameraMode = CameraMode::Explore;
 
     Shading shading = Shading::Phong;
+
+    BezierMode bezierMode = BezierMode::Adaptive;
+
+    bool printStats = false;
+    bool printMemory = false;
 };
 
 GlobalAttributes* callback_attributes = NULL;
 
-int main()
+int main(int argc, char **argv)
 {
     GlobalAttributes attr;
     callback_attributes = &attr;
@@ -122,11 +161,6 @@ int main()
         attr.controlPointZs[i]         = (float)std::rand() * 1 / RAND_MAX;
     }
 
-    const int NR_SQR_VERTICES = 6;
-    const int NR_VX_ATTR = 9;
-
-    attr.triangles.resize((u_nr_points - 1) * (v_nr_points - 1) * NR_SQR_VERTICES * NR_VX_ATTR);
-
     const std::vector<std::string> faces{
         "skybox/right.jpg",
         "skybox/left.jpg",
@@ -136,6 +170,25 @@ int main()
         "skybox/back.jpg"
     };
 
+    if (argc > 1 && std::string(argv[1]) == "--cook-textures")
+    {
+        // offline step: BCn + mipmaps into "<image>.ktx", picked up on the next start
+        return cookTextures({"city", "shuttle"}, faces) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::string(argv[i]) == "--bezier-resolution") {
+            attr.bezierResolution = std::max(BEZIER_MIN_RESOLUTION,
+                                             std::min(BEZIER_MAX_RESOLUTION, std::atoi(argv[i + 1])));
+        }
+    }
+
+    if (argc > 1 && std::string(argv[1]) == "--bench-bezier")
+    {
+        // CPU surface evaluation: per-sample basis against tabulated basis
+        return benchBezier() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
     glfwInit();
     glfwWindowHint(GLFW_SAMPLES, 4); // antialiasing
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, GL_MAJOR);
@@ -174,58 +227,102 @@ int main()
 
     // enable
 
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_CULL_FACE);
+    glState.setDepthTest(true);
+    glState.setCullFace(true);
     glEnable(GL_MULTISAMPLE);
     
+    // shader init; programs compile in the background while the models and
+    // textures below are loaded, and are waited for on first use
+
+    Shader skyboxShader("skybox_shader_vert.glsl", "skybox_shader_frag.glsl");
+    Shader lightShader("light_shader_vert.glsl", "light_shader_frag.glsl");
+
+    UniformBuffer<FrameBlock> frameUniforms(FRAME_BLOCK_BINDING);
+    UniformBuffer<ObjectBlock> objectUniforms(OBJECT_BLOCK_BINDING);
+    UniformBuffer<BezierBlock> bezierUniforms(BEZIER_BLOCK_BINDING);
+
+    // lit programs: every shading mode compiles one permutation per feature
+    // set (light counts, specular map, fog, day/night) on first request
+    ShaderVariants litVariants[3] = {
+        {"flat_shader_vert.glsl", "flat_shader_frag.glsl", "flat_shader_geom.glsl"},
+        {"gouraud_shader_vert.glsl", "gouraud_shader_frag.glsl"},
+        {"phong_shader_vert.glsl", "phong_shader_frag.glsl"}};
+
+    // a newly requested program keeps compiling while an already built one
+    // with the same features draws
+    auto litShader = [&litVariants, &attr](const ShaderFeatures &features) -> Shader & {
+        Shader &requested = litVariants[static_cast<int>(attr.shading)].get(features);
+        if (requested.ready())
+            return requested;
+        for (ShaderVariants &variants : litVariants) {
+            Shader *built = variants.find(features);
+            if (built && built->ready())
+                return *built;
+        }
+        return requested;
+    };
+
+    // the permutations of the first frame (fogged city, unfogged shuttle,
+    // GPU Bezier surface)
+    ShaderFeatures startupFeatures;
+    startupFeatures.night = !attr.day;
+    litShader(startupFeatures);
+    startupFeatures.fog = false;
+    litShader(startupFeatures);
+    startupFeatures.fog = true;
+    startupFeatures.bezierSurface = true;
+    startupFeatures.bezierTiles = true;
+    startupFeatures.solidColor = true;
+    litShader(startupFeatures);
+
     // Bezier init
 
-    glGenVertexArrays(1, &attr.trVAO);
-    glGenBuffers(1, &attr.trVBO);
+    const std::size_t gridPointCount = (std::size_t)attr.bezierResolution * attr.bezierResolution;
+    StreamBuffer bezierStream(GL_ARRAY_BUFFER, 2 * gridPointCount * sizeof(glm::vec3));
+    StreamBuffer tileStream(GL_ARRAY_BUFFER, (BezierTiles::MAX_LEVEL + 1) * BezierTiles::TILES_PER_SIDE *
+                                             BezierTiles::TILES_PER_SIDE * sizeof(BezierTiles::Instance));
 
-    glBindBuffer(GL_ARRAY_BUFFER, attr.trVBO);
-    glBufferData(GL_ARRAY_BUFFER, attr.triangles.size() * sizeof(float), NULL, GL_STREAM_DRAW);
-    glBindVertexArray(attr.trVAO);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void *)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void *)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void *)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
+    createBezierGrid(attr, bezierStream);
+    createBezierTiles(attr, tileStream);
 
     // skybox init
 
     unsigned int skyboxVAO, skyboxVBO;
     glGenVertexArrays(1, &skyboxVAO);
     glGenBuffers(1, &skyboxVBO);
-    glBindVertexArray(skyboxVAO);
+    glState.bindVertexArray(skyboxVAO);
     glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)0);
+    glState.bindVertexArray(0);
 
     unsigned int cubemapTexture = loadCubemap(faces.data());
 
-    // shader init
-
-    Shader skyboxShader("skybox_shader_vert.glsl", "skybox_shader_frag.glsl");
-    Shader lightShader("light_shader_vert.glsl", "light_shader_frag.glsl");
+    // gamma correction enabled, shaders only read position, normal and UV
 
-    Shader flatShader("flat_shader_vert.glsl",
-                      "flat_shader_frag.glsl",
-                      "flat_shader_geom.glsl");
+    ModelOptions staticModelOptions;
+    staticModelOptions.gamma = true;
+    staticModelOptions.vertexFormat = VertexFormat::Compact;
+    staticModelOptions.batched = true;
+    staticModelOptions.optimize = true;
+    staticModelOptions.normalMode = NormalMode::Faceted;
+    staticModelOptions.residency = MeshResidency::DropAfterUpload;
 
-    Shader gouraudShader("gouraud_shader_vert.glsl", "gouraud_shader_frag.glsl");
-    Shader phongShader("phong_shader_vert.glsl", "phong_shader_frag.glsl");
+    Model cityModel_meshes("city/FabConvert.com_city.obj", staticModelOptions);
+    //Model moonModel_meshes("moon/FabConvert.com_nasa_cgi_moon_kit.obj", staticModelOptions);
+    Model shuttleModel_meshes("shuttle/FabConvert.com_orbiter_space_shuttle_ov-103_discovery.obj", staticModelOptions);
 
     skyboxShader.use();
     skyboxShader.setInt("skybox", 0);
 
-    // gamma correction enabled
+    // texture uploads above bound textures with raw GL calls
+    glState.invalidate();
+
+    const bool citySpecular = cityModel_meshes.hasTexture(TextureType::Specular);
+    const bool shuttleSpecular = shuttleModel_meshes.hasTexture(TextureType::Specular);
 
-    Model cityModel_meshes("city/FabConvert.com_city.obj", true);
-    //Model moonModel_meshes("moon/FabConvert.com_nasa_cgi_moon_kit.obj", true);
-    Model shuttleModel_meshes("shuttle/FabConvert.com_orbiter_space_shuttle_ov-103_discovery.obj", true);
+    RenderQueue renderQueue;
 
     float angle = 0;          // shuttle flying around
     float angleOffset = 0.3f; // rotating reflectors
@@ -236,6 +333,18 @@ int main()
         attr.deltaTime = currentFrame - attr.lastFrame;
         attr.lastFrame = currentFrame;
 
+        if (attr.printStats) {
+            std::cout << '\n' << renderStats << '\n';
+            attr.printStats = false;
+        }
+        renderStats.reset();
+
+        if (attr.printMemory) {
+            cityModel_meshes.printMemoryReport(std::cout);
+            shuttleModel_meshes.printMemoryReport(std::cout);
+            attr.printMemory = false;
+        }
+
         // adjusting
 
         if (attr.shuttleMoving) {
@@ -258,7 +367,7 @@ int main()
         // projection
 
         glm::mat4 projection = glm::perspective(glm::radians(attr.camera.Zoom), // zoom enabled
-            (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 10000.f);
+            (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, FAR_PLANE);
 
         // model
 
@@ -336,147 +445,182 @@ int main()
 
         // main objects
 
-        Shader &mainShader = (attr.shading == Shading::Flat ? flatShader :
-                             (attr.shading == Shading::Gouraud ? gouraudShader : phongShader));
-        
-        mainShader.use();
-
-        mainShader.setFloat("gamma", attr.gamma_val);
-        mainShader.setFloat("lights[0].constant", 1.f); // sun
-        mainShader.setFloat("lights[1].constant", 1.f); // moon
-        mainShader.setFloat("lights[2].constant", 1.f); // refl 1
-        mainShader.setFloat("lights[3].constant", 1.f); // refl 2
-
-        mainShader.setFloat("lights[0].linear", 0.0001f);
-        mainShader.setFloat("lights[1].linear", 0.001f);
-        mainShader.setFloat("lights[2].linear", 0.01f);
-        mainShader.setFloat("lights[3].linear", 0.01f);
-        
-        mainShader.setFloat("lights[0].quadratic", 0.00f); // gamma correction enabled
-        mainShader.setFloat("lights[1].quadratic", 0.00f);
-        mainShader.setFloat("lights[2].quadratic", 0.00f);
-        mainShader.setFloat("lights[3].quadratic", 0.00f);
-        
-        mainShader.setFloat("spotlightComponents[0].cutOff", glm::cos(glm::radians(12.5f)));
-        mainShader.setFloat("spotlightComponents[1].cutOff", glm::cos(glm::radians(12.5f)));
-
-        mainShader.setFloat("spotlightComponents[0].outerCutoff", glm::cos(glm::radians(17.5f)));
-        mainShader.setFloat("spotlightComponents[1].outerCutoff", glm::cos(glm::radians(17.5f)));
+
+        // lighting, written once for every lit program
+
+        FrameBlock frame = {};
+        frame.view = view;
+        frame.projection = projection;
+        frame.gamma = attr.gamma_val;
+
+        const glm::mat4 lightModels[NR_LIGHTS] = {sunModel, moonModel, refl1Model, refl2Model};
+        const float lightLinear[NR_LIGHTS] = {0.0001f, 0.001f, 0.01f, 0.01f};
+
+        for (int i = 0; i < NR_LIGHTS; ++i) {
+            frame.lights[i].constant = 1.f;
+            frame.lights[i].linear = lightLinear[i];
+            frame.lights[i].quadratic = 0.f; // gamma correction enabled
+            frame.lights[i].lightPosView = view * lightModels[i] * glm::vec4(0.f, 0.f, 0.f, 1.f);
+        }
+
+        for (int i = 0; i < NR_SPOTLIGHTS; ++i) {
+            frame.spotlightComponents[i].cutOff = glm::cos(glm::radians(12.5f));
+            frame.spotlightComponents[i].outerCutoff = glm::cos(glm::radians(17.5f));
+        }
+
+        frame.spotlightComponents[0].spotDirectionView = shuttleDirectionView1;
+        frame.spotlightComponents[1].spotDirectionView = shuttleDirectionView2;
 
         if (attr.day)
         {
-            mainShader.setVec3("lights[0].ambientLightColor", glm::vec3(0.08f, 0.08f, 0.08f));
-            mainShader.setVec3("lights[1].ambientLightColor", glm::vec3(0.f, 0.f, 0.f));
-            mainShader.setVec3("lights[2].ambientLightColor", glm::vec3(0.f, 0.f, 0.f));
-            mainShader.setVec3("lights[3].ambientLightColor", glm::vec3(0.f, 0.f, 0.f));
-
-            mainShader.setVec3("lights[0].diffuseLightColor", glm::vec3(1.f, 1.f, 1.f));
-            mainShader.setVec3("lights[1].diffuseLightColor", glm::vec3(0.1f, 0.25f, 0.25f)); // moon is slightly lighting
-            mainShader.setVec3("lights[2].diffuseLightColor", glm::vec3(1.f, 1.f, 1.f));
-            mainShader.setVec3("lights[3].diffuseLightColor", glm::vec3(1.f, 1.f, 1.f));
-
-            mainShader.setVec3("lights[0].specularLightColor", glm::vec3(0.5f, 0.5f, 0.5f));
-            mainShader.setVec3("lights[1].specularLightColor", glm::vec3(0.1f, 0.35f, 0.35f));
-            mainShader.setVec3("lights[2].specularLightColor", glm::vec3(0.6f, 0.6f, 0.6f));
-            mainShader.setVec3("lights[3].specularLightColor", glm::vec3(0.6f, 0.6f, 0.6f));
+            frame.lights[0].ambientLightColor = glm::vec3(0.08f, 0.08f, 0.08f);
+            frame.lights[1].ambientLightColor = glm::vec3(0.f, 0.f, 0.f);
+            frame.lights[2].ambientLightColor = glm::vec3(0.f, 0.f, 0.f);
+            frame.lights[3].ambientLightColor = glm::vec3(0.f, 0.f, 0.f);
+
+            frame.lights[0].diffuseLightColor = glm::vec3(1.f, 1.f, 1.f);
+            frame.lights[1].diffuseLightColor = glm::vec3(0.1f, 0.25f, 0.25f); // moon is slightly lighting
+            frame.lights[2].diffuseLightColor = glm::vec3(1.f, 1.f, 1.f);
+            frame.lights[3].diffuseLightColor = glm::vec3(1.f, 1.f, 1.f);
+
+            frame.lights[0].specularLightColor = glm::vec3(0.5f, 0.5f, 0.5f);
+            frame.lights[1].specularLightColor = glm::vec3(0.1f, 0.35f, 0.35f);
+            frame.lights[2].specularLightColor = glm::vec3(0.6f, 0.6f, 0.6f);
+            frame.lights[3].specularLightColor = glm::vec3(0.6f, 0.6f, 0.6f);
+
+            frame.fogColor = glm::vec3(0.2f, 0.2f, 0.2f);
         }
         else
         {
-            mainShader.setVec3("lights[0].ambientLightColor", glm::vec3(0.028f, 0.028f, 0.028f));
-            mainShader.setVec3("lights[1].ambientLightColor", glm::vec3(0.f, 0.f, 0.f));
-            mainShader.setVec3("lights[2].ambientLightColor", glm::vec3(0.f, 0.f, 0.f));
-            mainShader.setVec3("lights[3].ambientLightColor", glm::vec3(0.f, 0.f, 0.f));
-
-            mainShader.setVec3("lights[0].diffuseLightColor", glm::vec3(0.f, 0.f, 0.f));
-            mainShader.setVec3("lights[1].diffuseLightColor", glm::vec3(0.27f, 0.12f, 0.08f));
-            mainShader.setVec3("lights[2].diffuseLightColor", glm::vec3(1.f, 1.f, 1.f));
-            mainShader.setVec3("lights[3].diffuseLightColor", glm::vec3(1.f, 1.f, 1.f));
-
-            mainShader.setVec3("lights[0].specularLightColor", glm::vec3(0.f, 0.f, 0.f));
-            mainShader.setVec3("lights[1].specularLightColor", glm::vec3(0.9f, 0.4f, 0.2f));
-            mainShader.setVec3("lights[2].specularLightColor", glm::vec3(0.6f, 0.6f, 0.6f));
-            mainShader.setVec3("lights[3].specularLightColor", glm::vec3(0.6f, 0.6f, 0.6f));
+            frame.lights[0].ambientLightColor = glm::vec3(0.028f, 0.028f, 0.028f);
+            frame.lights[1].ambientLightColor = glm::vec3(0.f, 0.f, 0.f);
+            frame.lights[2].ambientLightColor = glm::vec3(0.f, 0.f, 0.f);
+            frame.lights[3].ambientLightColor = glm::vec3(0.f, 0.f, 0.f);
+
+            frame.lights[0].diffuseLightColor = glm::vec3(0.f, 0.f, 0.f);
+            frame.lights[1].diffuseLightColor = glm::vec3(0.27f, 0.12f, 0.08f);
+            frame.lights[2].diffuseLightColor = glm::vec3(1.f, 1.f, 1.f);
+            frame.lights[3].diffuseLightColor = glm::vec3(1.f, 1.f, 1.f);
+
+            frame.lights[0].specularLightColor = glm::vec3(0.f, 0.f, 0.f);
+            frame.lights[1].specularLightColor = glm::vec3(0.9f, 0.4f, 0.2f);
+            frame.lights[2].specularLightColor = glm::vec3(0.6f, 0.6f, 0.6f);
+            frame.lights[3].specularLightColor = glm::vec3(0.6f, 0.6f, 0.6f);
+
+            frame.fogColor = glm::vec3(0.1f, 0.02f, 0.f);
         }
 
-        mainShader.setVec3("spotlightComponents[0].spotDirectionView", shuttleDirectionView1);
-        mainShader.setVec3("spotlightComponents[1].spotDirectionView", shuttleDirectionView2);
+        frameUniforms.update(frame);
 
-        mainShader.setMat4("view", view);
-        mainShader.setMat4("projection", projection);
+        const float fogDensity = attr.day ? attr.fogDensityDay : attr.fogDensityNight;
 
-        // city
+        ShaderFeatures features;
+        features.night = !attr.day;
+        features.fog = fogDensity > 0.f;
 
-        mainShader.setMat4("model", cityModel);
-        mainShader.setMat3("normViewModelMatrix", normMatrix(view * cityModel));
+        renderQueue.begin(view, projection, FAR_PLANE);
 
-        mainShader.setVec3("lights[0].lightPosView", view * sunModel * glm::vec4(0.f, 0.f, 0.f, 1.f)); // sun
-        mainShader.setVec3("lights[1].lightPosView", view * moonModel * glm::vec4(0.f, 0.f, 0.f, 1.f)); // moon
-        mainShader.setVec3("lights[2].lightPosView", view * refl1Model * glm::vec4(0.f, 0.f, 0.f, 1.f)); // refl 1
-        mainShader.setVec3("lights[3].lightPosView", view * refl2Model * glm::vec4(0.f, 0.f, 0.f, 1.f)); // refl 2
-        
-        mainShader.setFloat("shininess", cityShininess);
+        // city
 
-        if (attr.day) {
-            mainShader.setFloat("fogDensity", attr.fogDensityDay);
-            mainShader.setVec3("fogColor", glm::vec3(0.2f, 0.2f, 0.2f));
-        } else {
-            mainShader.setFloat("fogDensity", attr.fogDensityNight);
-            mainShader.setVec3("fogColor", glm::vec3(0.1f, 0.02f, 0.f));
-        }
+        features.specularMap = citySpecular;
 
-        cityModel_meshes.Draw(mainShader);
+        ObjectBlock object = {};
+        object.model = cityModel;
+        object.shininess = cityShininess;
+        object.fogDensity = fogDensity;
 
-        // moon
+        renderQueue.addInstance(cityModel_meshes, litShader(features), object);
 
-        mainShader.setFloat("fogDensity", 0.f);
+        // moon
 
-        mainShader.setMat4("model", moonModel);
-        mainShader.setMat3("normViewModelMatrix", normMatrix(view * moonModel));
-        mainShader.setFloat("shininess", moonShininess);
+        object = {};
+        object.model = moonModel;
+        object.shininess = moonShininess;
 
-        if (attr.day) {
-            mainShader.setVec3("lights[0].diffuseLightColor", glm::vec3(1.f, 1.f, 1.f));
-        } else {
-            mainShader.setVec3("lights[0].diffuseLightColor", glm::vec3(0.9f, 0.4f, 0.2f));
+        if (!attr.day) {
+            object.lightDiffuseOverride[0] = glm::vec4(0.9f, 0.4f, 0.2f, 1.f);
         }
 
-        //moonModel_meshes.Draw(mainShader);
+        // the night override lights the moon with lights[0], which the NIGHT
+        // permutation leaves out
+        //ShaderFeatures moonFeatures = features;
+        //moonFeatures.night = false;
+        //moonFeatures.fog = false;
+        //renderQueue.addInstance(moonModel_meshes, litShader(moonFeatures), object);
 
         // shuttle
 
-        if (attr.day) {
-            mainShader.setVec3("lights[0].diffuseLightColor", glm::vec3(1.f, 1.f, 1.f));
-        } else {
-            mainShader.setVec3("lights[0].diffuseLightColor", glm::vec3(0.f, 0.f, 0.f));
-        }
+        object = {};
+        object.model = shuttleModel;
+        object.shininess = shuttleShininess;
 
-        mainShader.setMat4("model", shuttleModel);
-        mainShader.setMat3("normViewModelMatrix", normMatrix(view * shuttleModel));
-        mainShader.setFloat("shininess", shuttleShininess);
-        shuttleModel_meshes.Draw(mainShader);
+        ShaderFeatures shuttleFeatures = features;
+        shuttleFeatures.fog = false;
+        shuttleFeatures.specularMap = shuttleSpecular;
+        renderQueue.addInstance(shuttleModel_meshes, litShader(shuttleFeatures), object);
 
         // Bezier surface
 
-        glBindVertexArray(attr.trVAO);
-        mainShader.setMat4("model", bezierModel);
-        mainShader.setMat3("normViewModelMatrix", normMatrix(view * bezierModel));
-        mainShader.setFloat("shininess", shuttleShininess);
+        features.specularMap = true;
 
-        updateTriangles(attr);
+        object = {};
+        object.model = bezierModel;
+        object.shininess = shuttleShininess;
+        object.fogDensity = fogDensity;
 
-        if (attr.day) {
-            mainShader.setFloat("fogDensity", attr.fogDensityDay);
-            mainShader.setVec3("fogColor", glm::vec3(0.2f, 0.2f, 0.2f));
-        } else {
-            mainShader.setFloat("fogDensity", attr.fogDensityNight);
-            mainShader.setVec3("fogColor", glm::vec3(0.1f, 0.02f, 0.f));
-        }
+        ShaderFeatures bezierFeatures = features;
+        bezierFeatures.bezierSurface = attr.bezierMode != BezierMode::CPU;
+        bezierFeatures.bezierTiles = attr.bezierMode == BezierMode::Adaptive;
+        bezierFeatures.solidColor = true;
+
+        if (attr.bezierGrid.uPoints() != attr.bezierResolution)
+            createBezierGrid(attr, bezierStream);
 
-        glDisable(GL_CULL_FACE); // disable face culling to draw both sides
-        glDrawArrays(GL_TRIANGLES, 0, attr.triangles.size());
-        glEnable(GL_CULL_FACE);
+        BezierBlock bezier;
+        animateControlPoints(attr, &bezier.controlHeights[0].x);
 
-        mainShader.setFloat("fogDensity", 0.f);
+        Shader &bezierShader = litShader(bezierFeatures);
+        bezierShader.use();
+        bezierShader.setVec3("solidColor", bezierColor);
+
+        DrawPacket bezierPacket;
+        bezierPacket.shader = &bezierShader;
+        bezierPacket.object = renderQueue.addObject(object);
+        bezierPacket.cullFace = false; // draw both sides
+
+        if (attr.bezierMode == BezierMode::CPU) {
+            bezierPacket.VAO = attr.trVAO;
+            bezierPacket.count = attr.gridIndexCount;
+            bezierPacket.baseVertex = updateBezierVertices(attr, &bezier.controlHeights[0].x, bezierStream);
+            renderQueue.push(bezierPacket);
+        }
+        else {
+            // only the 16 control heights are uploaded
+            bezierUniforms.update(bezier);
+
+            if (attr.bezierMode == BezierMode::Uniform) {
+                bezierPacket.VAO = attr.gridVAO;
+                bezierPacket.count = attr.gridIndexCount;
+                renderQueue.push(bezierPacket);
+            }
+            else {
+                attr.bezierTiles.select(&bezier.controlHeights[0].x, bezierModel, view, projection,
+                                        (float)SCR_HEIGHT, BEZIER_MAX_PIXEL_ERROR);
+                const bool tilesReady = uploadBezierTiles(attr, tileStream);
+
+                // one instanced draw per level in use
+                for (int level = 0; tilesReady && level <= BezierTiles::MAX_LEVEL; ++level) {
+                    const std::size_t tiles = attr.bezierTiles.instances(level).size();
+                    if (tiles == 0)
+                        continue;
+
+                    bezierPacket.VAO = attr.tileVAOs[level];
+                    bezierPacket.count = attr.tileIndexCounts[level];
+                    bezierPacket.instanceCount = (GLsizei)tiles;
+                    renderQueue.push(bezierPacket);
+                }
+            }
+        }
 
         // sun
 
@@ -501,26 +645,37 @@ int main()
 
         // skybox
 
-        glDepthFunc(GL_LEQUAL);
         skyboxShader.use();
         view = glm::mat4(glm::mat3(view)); // view without translation
         skyboxShader.setMat4("view", view);
         skyboxShader.setMat4("projection", projection);
 
-        glBindVertexArray(skyboxVAO);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
+        if (attr.day) {
+            DrawPacket skyboxPacket;
+            skyboxPacket.kind = DrawPacket::Kind::Arrays;
+            skyboxPacket.layer = RenderLayer::Sky;
+            skyboxPacket.shader = &skyboxShader;
+            skyboxPacket.cubeMap = cubemapTexture;
+            skyboxPacket.VAO = skyboxVAO;
+            skyboxPacket.depthFunc = GL_LEQUAL;
+            skyboxPacket.count = 36;
+            renderQueue.push(skyboxPacket);
+        }
 
-        if (attr.day)
-            glDrawArrays(GL_TRIANGLES, 0, 36);
+        // packets are built and culled on the pool, then sorted by state
+        // and depth; only the replay touches GL
+        renderQueue.build(ThreadPool::shared());
+        renderQueue.submit(objectUniforms);
 
-        glBindVertexArray(0);
-        glDepthFunc(GL_LESS);
+        // the Bezier regions may be rewritten once these draws are done
+        bezierStream.fence();
+        tileStream.fence();
 
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
 
+    TextureRegistry::instance().shutdown();
     glfwTerminate();
     return EXIT_SUCCESS;
 }
@@ -616,6 +771,28 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action, int mod
     {
         attr.shuttleMoving = !attr.shuttleMoving;
     }
+    if (key == GLFW_KEY_B && action == GLFW_PRESS)
+    {
+        attr.bezierMode = attr.bezierMode == BezierMode::Adaptive ? BezierMode::Uniform :
+                          attr.bezierMode == BezierMode::Uniform  ? BezierMode::CPU :
+                                                                    BezierMode::Adaptive;
+    }
+    if (key == GLFW_KEY_MINUS && action == GLFW_PRESS)
+    {
+        attr.bezierResolution = std::max(BEZIER_MIN_RESOLUTION, attr.bezierResolution / 2);
+    }
+    if (key == GLFW_KEY_EQUAL && action == GLFW_PRESS)
+    {
+        attr.bezierResolution = std::min(BEZIER_MAX_RESOLUTION, attr.bezierResolution * 2);
+    }
+    if (key == GLFW_KEY_I && action == GLFW_PRESS)
+    {
+        attr.printStats = true;
+    }
+    if (key == GLFW_KEY_M && action == GLFW_PRESS)
+    {
+        attr.printMemory = true;
+    }
     if (key == GLFW_KEY_Z && action == GLFW_PRESS) {
         attr.reflectorsUp = true;
     }
@@ -675,20 +852,19 @@ unsigned int loadCubemap(const std::string* faces,
 
     stbi_set_flip_vertically_on_load(flipVertBefore);
 
-    int width, height, nrChannels;
+    const std::vector<int> compressedFormats = queryCompressedFormats();
+    const int maxTextureSize = queryMaxTextureSize();
     for (unsigned int i = 0; i < 6; i++)
     {
-        unsigned char *data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
-        if (data)
+        DecodedImage image;
+        if (decodeImage(faces[i], image, compressedFormats, maxTextureSize))
         {
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height,
-                         0, GL_RGB, GL_UNSIGNED_BYTE, data);
+            uploadImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, image);
         }
         else
         {
             std::cout << "Cubemap texture failed to load at path: " << faces[i] << '\n';
         }
-        stbi_image_free(data);
     }
 
     stbi_set_flip_vertically_on_load(flipVertAfter);
@@ -702,158 +878,181 @@ unsigned int loadCubemap(const std::string* faces,
     return textureID;
 }
 
-void updateTriangles(GlobalAttributes& attr)
+void animateControlPoints(const GlobalAttributes& attr, float *heights)
 {
     const int NR_CTRL_PT = (BEZIER_M+1) * (BEZIER_N+1);
-    float controlPointCurrZs[NR_CTRL_PT];
 
     const float BEZIER_ANIMATION_STRENGTH = 0.1f;
 
     for (int i = 0; i < NR_CTRL_PT; ++i) {
-        controlPointCurrZs[i] = attr.controlPointZs[i] +
-                                BEZIER_ANIMATION_STRENGTH * attr.controlPointAmplitudes[i] *
-                                      std::sin(glfwGetTime() + attr.controlPointPhases[i]);
-    }
-
-    std::vector<glm::vec3> points;
-    std::vector<glm::vec3> n_vecs;
-
-    points.resize(u_nr_points * v_nr_points);
-    n_vecs.resize(u_nr_points * v_nr_points);
-
-    // Bezier update
-
-    for (int i = 0; i < u_nr_points; ++i)
-    {
-        for (int j = 0; j < v_nr_points; ++j)
-        {
-            float u = (float)i / (u_nr_points - 1);
-            float v = (float)j / (v_nr_points - 1);
-
-            points[j * u_nr_points + i] = Pfunc(u, v, controlPointCurrZs);
-            n_vecs[j * u_nr_points + i] = glm::normalize(NVec(u, v, controlPointCurrZs));
-        }
+        heights[i] = attr.controlPointZs[i] +
+                     BEZIER_ANIMATION_STRENGTH * attr.controlPointAmplitudes[i] *
+                           std::sin(glfwGetTime() + attr.controlPointPhases[i]);
     }
+}
 
-    const int NR_SQR_VERTICES = 6;
-    const int NR_VX_ATTR = 9;
+void createBezierGrid(GlobalAttributes& attr, StreamBuffer& stream)
+{
+    const int resolution = attr.bezierResolution;
+    const std::size_t pointCount = (std::size_t)resolution * resolution;
 
-    attr.triangles.clear();
-    attr.triangles.reserve((u_nr_points - 1) * (v_nr_points - 1) * NR_SQR_VERTICES * NR_VX_ATTR);
+    std::vector<glm::vec2> uvs;
+    uvs.reserve(pointCount);
 
-    const float r = bezierColor.r;
-    const float g = bezierColor.g;
-    const float b = bezierColor.b;
+    for (int j = 0; j < resolution; ++j)
+        for (int i = 0; i < resolution; ++i)
+            uvs.emplace_back((float)i / (resolution - 1), (float)j / (resolution - 1));
 
+    // two triangles per grid quad
     const int j_indices[] = {0, 0, 1, 1, 0, 1};
     const int i_indices[] = {0, 1, 0, 0, 1, 1};
 
-    for (int i = 0; i < u_nr_points - 1; ++i) {
-        for (int j = 0; j < v_nr_points - 1; ++j) {
-            for (int k = 0; k < NR_SQR_VERTICES; ++k) {
+    std::vector<unsigned int> indices;
+    indices.reserve((std::size_t)(resolution - 1) * (resolution - 1) * 6);
 
-                attr.triangles.push_back(points[(j+j_indices[k]) * u_nr_points + (i+i_indices[k])].x);
-                attr.triangles.push_back(points[(j+j_indices[k]) * u_nr_points + (i+i_indices[k])].y);
-                attr.triangles.push_back(points[(j+j_indices[k]) * u_nr_points + (i+i_indices[k])].z);
+    for (int i = 0; i < resolution - 1; ++i)
+        for (int j = 0; j < resolution - 1; ++j)
+            for (int k = 0; k < 6; ++k)
+                indices.push_back((j + j_indices[k]) * resolution + (i + i_indices[k]));
 
-                attr.triangles.push_back(n_vecs[(j+j_indices[k]) * u_nr_points + (i+i_indices[k])].x);
-                attr.triangles.push_back(n_vecs[(j+j_indices[k]) * u_nr_points + (i+i_indices[k])].y);
-                attr.triangles.push_back(n_vecs[(j+j_indices[k]) * u_nr_points + (i+i_indices[k])].z);
+    attr.gridIndexCount = (GLsizei)indices.size();
+    attr.bezierGrid = BezierGrid(resolution, resolution);
 
-                attr.triangles.push_back(r);
-                attr.triangles.push_back(g);
-                attr.triangles.push_back(b);
-            }
-        }
+    if (!attr.gridVAO) {
+        glGenVertexArrays(1, &attr.gridVAO);
+        glGenBuffers(1, &attr.gridVBO);
+        glGenBuffers(1, &attr.gridEBO);
+        glGenVertexArrays(1, &attr.trVAO);
     }
 
-    glBindBuffer(GL_ARRAY_BUFFER, attr.trVBO);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, attr.triangles.size() * sizeof(float), attr.triangles.data());
-}
-
-// BEZIER SURFACE functions
+    glState.bindVertexArray(attr.gridVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, attr.gridVBO);
+    glBufferData(GL_ARRAY_BUFFER, uvs.size() * sizeof(glm::vec2), uvs.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, attr.gridEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
 
-template<class T>
-T quick_power(T x, int y) {
-    if (y == 0) { return (T)1; }
-    if (y == 1) { return x; }
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void *)0);
+    glEnableVertexAttribArray(0);
 
-    if (y & 1) {
-        return quick_power(x, y-1) * x;
-    }
+    // the CPU path: a region is two grid's worth of vertices, so the region
+    // offset is a base vertex and the attribute offsets stay fixed
+    const std::size_t regionBytes = 2 * pointCount * sizeof(glm::vec3);
+    if (stream.regionBytes() != regionBytes)
+        stream.resize(regionBytes);
 
-    T val = quick_power(x, y >> 1);
-    return val * val;
+    glState.bindVertexArray(attr.trVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, stream.id());
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, attr.gridEBO);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void *)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void *)(pointCount * sizeof(glm::vec3)));
+    glEnableVertexAttribArray(1);
+    glState.bindVertexArray(0);
 }
 
-int binomialCoeff(int i, int n)
+void createBezierTiles(GlobalAttributes& attr, const StreamBuffer& stream)
 {
-    long long x = 1, y = 1;
-    for (int k = 1; k <= i; ++k)
-    {
-        x *= k + n - i;
-        y *= k;
-    }
-    return x / y;
-}
+    glGenVertexArrays(BezierTiles::MAX_LEVEL + 1, attr.tileVAOs);
 
-float Bfunction(float t, int n, int i)
-{
-    return binomialCoeff(i, n) * quick_power(t, i) * quick_power(1.f - t, n - i);
-}
+    // two triangles per lattice quad
+    const int j_indices[] = {0, 0, 1, 1, 0, 1};
+    const int i_indices[] = {0, 1, 0, 0, 1, 1};
 
-float Zfunction(float x, float y, const float *points)
-{
-    float result = 0;
-    for (int i = 0; i <= BEZIER_N; ++i)
-    {
-        for (int j = 0; j <= BEZIER_M; ++j)
-        {
-            float pt = points[j * (BEZIER_N+1) + i];
-            result += pt * Bfunction(x, BEZIER_N, i) * Bfunction(y, BEZIER_M, j);
-        }
+    for (int level = 0; level <= BezierTiles::MAX_LEVEL; ++level) {
+        const int quads = 1 << level;
+
+        // integer lattice coordinates, scaled by the vertex shader
+        std::vector<glm::vec2> lattice;
+        lattice.reserve((quads + 1) * (quads + 1));
+        for (int j = 0; j <= quads; ++j)
+            for (int i = 0; i <= quads; ++i)
+                lattice.emplace_back((float)i, (float)j);
+
+        std::vector<unsigned int> indices;
+        indices.reserve(quads * quads * 6);
+        for (int i = 0; i < quads; ++i)
+            for (int j = 0; j < quads; ++j)
+                for (int k = 0; k < 6; ++k)
+                    indices.push_back((j + j_indices[k]) * (quads + 1) + (i + i_indices[k]));
+
+        attr.tileIndexCounts[level] = (GLsizei)indices.size();
+
+        unsigned int VBO, EBO;
+        glGenBuffers(1, &VBO);
+        glGenBuffers(1, &EBO);
+
+        glState.bindVertexArray(attr.tileVAOs[level]);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, lattice.size() * sizeof(glm::vec2), lattice.data(), GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void *)0);
+        glEnableVertexAttribArray(0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+
+        glEnableVertexAttribArray(3);
+        glVertexAttribDivisor(3, 1);
+        glEnableVertexAttribArray(4);
+        glVertexAttribDivisor(4, 1);
     }
-    return result;
-}
 
-glm::vec3 Pfunc(float u, float v, const float *points)
-{
-    return glm::vec3(u, v, Zfunction(u, v, points));
+    attr.tileRegionOffset = 0;
+    pointBezierTiles(attr, stream, attr.tileRegionOffset);
 }
 
-glm::vec3 PuFunc(float u, float v, const float *points)
+void pointBezierTiles(const GlobalAttributes& attr, const StreamBuffer& stream, std::size_t regionOffset)
 {
-    glm::vec3 result(0.f, 0.f, 0.f);
-    for (int i = 0; i <= BEZIER_N - 1; ++i)
-    {
-        for (int j = 0; j <= BEZIER_M; ++j)
-        {
-            glm::vec3 Vi1j0{(float)(i + 1) / BEZIER_N, 0, points[(j + 0) * (BEZIER_N+1) + i + 1]};
-            glm::vec3 Vi0j0{(float)(i)     / BEZIER_N, 0, points[(j + 0) * (BEZIER_N+1) + i + 0]};
-            result += (Vi1j0 - Vi0j0) * Bfunction(u, BEZIER_N - 1, i) * Bfunction(v, BEZIER_M, j);
-        }
+    const std::size_t sliceBytes = BezierTiles::TILES_PER_SIDE * BezierTiles::TILES_PER_SIDE * sizeof(BezierTiles::Instance);
+
+    // each level reads its slice of the given region; without a base
+    // instance (GL 4.2) the region offset goes into the attribute offsets
+    glBindBuffer(GL_ARRAY_BUFFER, stream.id());
+    for (int level = 0; level <= BezierTiles::MAX_LEVEL; ++level) {
+        const std::size_t slice = regionOffset + level * sliceBytes;
+        glState.bindVertexArray(attr.tileVAOs[level]);
+        glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(BezierTiles::Instance),
+                              (void *)(slice + offsetof(BezierTiles::Instance, tile)));
+        glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(BezierTiles::Instance),
+                              (void *)(slice + offsetof(BezierTiles::Instance, edges)));
     }
-    return (float)BEZIER_N * result;
+    glState.bindVertexArray(0);
 }
 
-glm::vec3 PvFunc(float u, float v, const float *points)
+bool uploadBezierTiles(GlobalAttributes& attr, StreamBuffer& stream)
 {
-    glm::vec3 result(0.f, 0.f, 0.f);
-    for (int i = 0; i <= BEZIER_N; ++i)
-    {
-        for (int j = 0; j <= BEZIER_M - 1; ++j)
-        {
-            glm::vec3 Vi0j1{0, (float)(j + 1) / BEZIER_M, points[(j + 1) * (BEZIER_N+1) + i + 0]};
-            glm::vec3 Vi0j0{0, (float)(j)     / BEZIER_M, points[(j + 0) * (BEZIER_N+1) + i + 0]};
-            result += (Vi0j1 - Vi0j0) * Bfunction(u, BEZIER_N, i) * Bfunction(v, BEZIER_M - 1, j);
+    const std::size_t sliceBytes = BezierTiles::TILES_PER_SIDE * BezierTiles::TILES_PER_SIDE * sizeof(BezierTiles::Instance);
+
+    unsigned char *region = static_cast<unsigned char *>(stream.map());
+    if (region)
+        for (int level = 0; level <= BezierTiles::MAX_LEVEL; ++level) {
+            const std::vector<BezierTiles::Instance> &instances = attr.bezierTiles.instances(level);
+            if (!instances.empty())
+                std::memcpy(region + level * sliceBytes, instances.data(), instances.size() * sizeof(BezierTiles::Instance));
         }
+
+    const std::size_t regionOffset = stream.unmap();
+    if (!region)
+        return false;
+
+    // the ring cycles through a few regions, so the VAOs are re-pointed
+    // only when the region moves
+    if (regionOffset != attr.tileRegionOffset) {
+        attr.tileRegionOffset = regionOffset;
+        pointBezierTiles(attr, stream, regionOffset);
     }
-    return (float)BEZIER_M * result;
+    return true;
 }
 
-glm::vec3 NVec(float u, float v, const float *points)
+GLint updateBezierVertices(GlobalAttributes& attr, const float *heights, StreamBuffer& stream)
 {
-    return glm::cross(PuFunc(u, v, points), PvFunc(u, v, points));
+    const std::size_t pointCount = (std::size_t)attr.bezierGrid.uPoints() * attr.bezierGrid.vPoints();
+
+    // Bezier update, row blocks on the pool straight into the mapped region
+
+    glm::vec3 *region = static_cast<glm::vec3 *>(stream.map());
+    if (region)
+        attr.bezierGrid.evaluate(heights, region, region + pointCount, ThreadPool::shared());
+
+    return static_cast<GLint>(stream.unmap() / sizeof(glm::vec3));
 }
 
 const float skyboxVertices[] = {
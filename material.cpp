@@ -0,0 +1,71 @@
+#include "material.h"
+#include "gl_state.h"
+#include "shader.h"
+
+#include <algorithm>
+#include <cstdio>
+
+const char *textureTypeName(TextureType type)
+{
+    switch (type)
+    {
+    case TextureType::Diffuse:
+        return "texture_diffuse";
+    case TextureType::Specular:
+        return "texture_specular";
+    case TextureType::Normal:
+        return "texture_normal";
+    case TextureType::Height:
+        return "texture_height";
+    }
+    return "";
+}
+
+Material Material::fromTextures(const std::vector<Texture> &textures)
+{
+    Material material;
+    for (const Texture &texture : textures)
+    {
+        GLuint &slot = material.textures[static_cast<int>(texture.type)];
+        if (!slot)
+            slot = texture.id;
+    }
+    return material;
+}
+
+void Material::bind() const
+{
+    for (int unit = 0; unit < UNIT_COUNT; ++unit)
+    {
+        // units the material does not use keep whatever is bound
+        if (textures[unit])
+            glState.bindTexture(unit, GL_TEXTURE_2D, textures[unit]);
+    }
+}
+
+void Material::assignSamplers(const Shader &shader)
+{
+    for (int unit = 0; unit < UNIT_COUNT; ++unit)
+    {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%s1", textureTypeName(static_cast<TextureType>(unit)));
+        shader.bindSampler(name, unit);
+    }
+}
+
+bool Material::operator==(const Material &other) const
+{
+    return std::equal(textures, textures + UNIT_COUNT, other.textures);
+}
+
+std::uint16_t Material::sortKey() const
+{
+    // FNV-1a over the texture names
+    std::uint32_t hash = 2166136261u;
+    for (GLuint texture : textures)
+    {
+        hash ^= texture;
+        hash *= 16777619u;
+    }
+    return static_cast<std::uint16_t>(hash % 0xFFFF + 1);
+}
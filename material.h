@@ -0,0 +1,54 @@
+#ifndef MATERIAL_H
+#define MATERIAL_H
+#include <cstdint>
+#include <vector>
+#include <glad/glad.h>
+
+#include "texture_registry.h"
+
+class Shader;
+
+enum class TextureType
+{
+    Diffuse,
+    Specular,
+    Normal,
+    Height
+};
+
+// sampler name prefix in the shaders, e.g. "texture_diffuse"
+const char *textureTypeName(TextureType type);
+
+struct Texture
+{
+    unsigned int id;
+    TextureType type;
+    TextureHandle resource; // owns the GL texture and knows its file
+};
+
+// The textures of a mesh on fixed units, one unit per TextureType. Programs
+// point their samplers at these units once (assignSamplers), and binding
+// goes through GlState, so only units whose texture changed are touched.
+struct Material
+{
+    static const int UNIT_COUNT = 4;
+
+    GLuint textures[UNIT_COUNT] = {}; // 0 where the mesh has no such texture
+
+    // the first texture of every type; shaders sample only "<type>1"
+    static Material fromTextures(const std::vector<Texture> &textures);
+
+    static GLenum unit(TextureType type) { return GL_TEXTURE0 + static_cast<GLenum>(type); }
+
+    void bind() const;
+
+    static void assignSamplers(const Shader &shader);
+
+    bool operator==(const Material &other) const;
+
+    // non-zero id for draw sorting, equal for equal materials; a clash only
+    // interleaves two materials, so it needs no shared table
+    std::uint16_t sortKey() const;
+};
+
+#endif
@@ -0,0 +1,57 @@
+#include "memory_usage.h"
+
+#include <glad/glad.h>
+
+#include <iomanip>
+
+std::size_t textureGpuBytes(unsigned int textureID)
+{
+    GLint previous;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous);
+    glBindTexture(GL_TEXTURE_2D, textureID);
+
+    std::size_t bytes = 0;
+    for (GLint level = 0;; ++level)
+    {
+        GLint width = 0, height = 0, compressed = GL_FALSE;
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_WIDTH, &width);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_HEIGHT, &height);
+        if (width == 0 || height == 0)
+            break;
+
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED, &compressed);
+        if (compressed)
+        {
+            GLint size = 0;
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+            bytes += size;
+            continue;
+        }
+
+        GLint bits = 0;
+        for (GLenum component : {GL_TEXTURE_RED_SIZE, GL_TEXTURE_GREEN_SIZE, GL_TEXTURE_BLUE_SIZE, GL_TEXTURE_ALPHA_SIZE})
+        {
+            GLint size = 0;
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, level, component, &size);
+            bits += size;
+        }
+        bytes += static_cast<std::size_t>(width) * height * ((bits + 7) / 8);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, previous);
+    return bytes;
+}
+
+std::ostream &operator<<(std::ostream &os, const MemoryUsage &usage)
+{
+    const double MIB = 1024.0 * 1024.0;
+    const std::ios::fmtflags flags = os.flags();
+    const std::streamsize precision = os.precision();
+
+    os << std::fixed << std::setprecision(2)
+       << "cpu " << usage.cpuBytes / MIB << " MiB, gpu " << usage.gpuBytes / MIB << " MiB";
+
+    os.flags(flags);
+    os.precision(precision);
+    return os;
+}
@@ -0,0 +1,25 @@
+#ifndef MEMORY_USAGE_H
+#define MEMORY_USAGE_H
+#include <cstddef>
+#include <ostream>
+
+struct MemoryUsage
+{
+    std::size_t cpuBytes = 0;
+    std::size_t gpuBytes = 0;
+
+    MemoryUsage &operator+=(const MemoryUsage &other)
+    {
+        cpuBytes += other.cpuBytes;
+        gpuBytes += other.gpuBytes;
+        return *this;
+    }
+};
+
+// storage of every mip level of a 2D texture, as reported by the driver;
+// GL thread only
+std::size_t textureGpuBytes(unsigned int textureID);
+
+std::ostream &operator<<(std::ostream &os, const MemoryUsage &usage);
+
+#endif
@@ -1,102 +1,157 @@
 // http://learnopengl.com/
 #include "shader.h"
 #include "mesh.h"
+#include "gl_state.h"
+#include "render_stats.h"
+#include "mesh_optimizer.h"
 
-Mesh::Mesh(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices, const std::vector<Texture> &textures)
+Mesh::Mesh(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices, const std::vector<Texture> &textures, const VertexLayout &layout, bool createBuffers)
+    : layout(layout)
 {
     this->vertices = vertices;
     this->indices = indices;
     this->textures = textures;
+    material = Material::fromTextures(this->textures);
 
-    setupMesh();
+    setupMesh(createBuffers);
 }
 
-Mesh::Mesh(std::vector<Vertex> &&vertices, std::vector<unsigned int> &&indices, std::vector<Texture> &&textures)
+Mesh::Mesh(std::vector<Vertex> &&vertices, std::vector<unsigned int> &&indices, std::vector<Texture> &&textures, const VertexLayout &layout, bool createBuffers)
+    : layout(layout)
 {
     this->vertices = std::move(vertices);
     this->indices = std::move(indices);
     this->textures = std::move(textures);
+    material = Material::fromTextures(this->textures);
 
-    setupMesh();
+    setupMesh(createBuffers);
 }
 
-void Mesh::Draw(Shader &shader)
+Mesh::Mesh(const Vertex *vertices, std::size_t vertexCount, const unsigned int *indices, std::size_t indexCount, std::vector<Texture> &&textures, const VertexLayout &layout, MeshResidency residency)
+    : layout(layout)
 {
-    unsigned int diffuseNr = 1;
-    unsigned int specularNr = 1;
-    unsigned int normalNr = 1;
-    unsigned int heightNr = 1;
+    this->textures = std::move(textures);
+    material = Material::fromTextures(this->textures);
+
+    setupMesh(vertices, vertexCount, indices, indexCount, true);
 
-    for (unsigned int i = 0; i < textures.size(); i++)
+    if (residency == MeshResidency::KeepCPU)
+        this->vertices.assign(vertices, vertices + vertexCount);
+    if (residency != MeshResidency::DropAfterUpload)
+        this->indices.assign(indices, indices + indexCount);
+    if (residency == MeshResidency::PositionsOnly)
     {
-        glActiveTexture(GL_TEXTURE0 + i);
-
-        std::string number;
-        std::string name = textures[i].type;
-        if (name == "texture_diffuse")
-            number = std::to_string(diffuseNr++);
-        else if (name == "texture_specular")
-            number = std::to_string(specularNr++);
-        else if (name == "texture_normal")
-            number = std::to_string(normalNr++);
-        else if (name == "texture_height")
-            number = std::to_string(heightNr++);
-
-        glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
-        glBindTexture(GL_TEXTURE_2D, textures[i].id);
+        positions.resize(vertexCount);
+        for (std::size_t i = 0; i < vertexCount; ++i)
+            positions[i] = vertices[i].Position;
     }
+}
+
+void Mesh::Draw(Shader &)
+{
+    material.bind();
 
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+    glState.bindVertexArray(VAO);
+    glDrawElements(GL_TRIANGLES, indexCount, indexType, 0);
 
-    glActiveTexture(GL_TEXTURE0);
+    renderStats.drawCalls++;
+    renderStats.meshDraws++;
 }
 
-void Mesh::setupMesh()
+void Mesh::applyResidency(MeshResidency residency)
 {
-    // regenerate normal vectors!
-    for (std::size_t i = 0; i < indices.size() / 3; ++i)
+    if (residency == MeshResidency::KeepCPU)
+        return;
+
+    if (residency == MeshResidency::PositionsOnly)
     {
-        glm::vec3 a = vertices[indices[i * 3 + 0]].Position - vertices[indices[i * 3 + 1]].Position;
-        glm::vec3 b = vertices[indices[i * 3 + 2]].Position - vertices[indices[i * 3 + 1]].Position;
-        glm::vec3 n = glm::normalize(glm::cross(b, a));
-        vertices[indices[i * 3 + 0]].Normal = n;
-        vertices[indices[i * 3 + 1]].Normal = n;
-        vertices[indices[i * 3 + 2]].Normal = n;
+        // meshes built from a mapping already hold only what the policy keeps
+        if (vertices.empty())
+            return;
+
+        positions.resize(vertices.size());
+        for (std::size_t i = 0; i < vertices.size(); ++i)
+            positions[i] = vertices[i].Position;
     }
+    else
+        std::vector<unsigned int>().swap(indices);
 
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
+    std::vector<Vertex>().swap(vertices);
+}
 
-    glBindVertexArray(VAO);
+MemoryUsage Mesh::memoryUsage() const
+{
+    MemoryUsage usage;
+    usage.cpuBytes = sizeof(Mesh) +
+                     vertices.capacity() * sizeof(Vertex) +
+                     indices.capacity() * sizeof(unsigned int) +
+                     positions.capacity() * sizeof(glm::vec3) +
+                     textures.capacity() * sizeof(Texture) +
+                     layout.attributes.capacity() * sizeof(VertexAttribute);
+    usage.gpuBytes = bufferBytes;
+    return usage;
+}
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+void Mesh::setupMesh(bool createBuffers)
+{
+    setupMesh(vertices.data(), vertices.size(), indices.data(), indices.size(), createBuffers);
+}
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+void Mesh::setupMesh(const Vertex *vertexData, std::size_t vertexTotal,
+                     const unsigned int *indexData, std::size_t indexTotal, bool createBuffers)
+{
+    indexType = selectIndexType(vertexTotal);
+    indexCount = static_cast<unsigned int>(indexTotal);
+    vertexCount = static_cast<unsigned int>(vertexTotal);
 
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)0);
+    if (vertexTotal > 0)
+    {
+        boundsMin = boundsMax = vertexData[0].Position;
+        for (std::size_t i = 0; i < vertexTotal; ++i)
+        {
+            boundsMin = glm::min(boundsMin, vertexData[i].Position);
+            boundsMax = glm::max(boundsMax, vertexData[i].Position);
+        }
+    }
 
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, Normal));
+    if (!createBuffers)
+        return;
 
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, TexCoords));
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
 
-    glEnableVertexAttribArray(3);
-    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, Tangent));
+    glState.bindVertexArray(VAO);
 
-    glEnableVertexAttribArray(4);
-    glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, Bitangent));
+    // the full format and 32-bit indices match the source layout and go up
+    // without a staging copy
+    std::vector<unsigned char> packed;
+    const void *vertexSource = vertexData;
+    GLsizeiptr vertexBytes = static_cast<GLsizeiptr>(vertexTotal * sizeof(Vertex));
+    if (layout.format != VertexFormat::Full)
+    {
+        layout.pack(vertexData, vertexTotal, packed);
+        vertexSource = packed.data();
+        vertexBytes = static_cast<GLsizeiptr>(packed.size());
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, vertexBytes, vertexSource, GL_STATIC_DRAW);
 
-    glEnableVertexAttribArray(5);
-    glVertexAttribIPointer(5, 4, GL_INT, sizeof(Vertex), (void *)offsetof(Vertex, m_BoneIDs));
+    std::vector<unsigned char> packedIndices;
+    const void *indexSource = indexData;
+    GLsizeiptr indexBytes = static_cast<GLsizeiptr>(indexTotal * sizeof(unsigned int));
+    if (indexType != GL_UNSIGNED_INT)
+    {
+        packIndices(indexData, indexTotal, indexType, packedIndices);
+        indexSource = packedIndices.data();
+        indexBytes = static_cast<GLsizeiptr>(packedIndices.size());
+    }
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes, indexSource, GL_STATIC_DRAW);
+    bufferBytes = static_cast<std::size_t>(vertexBytes + indexBytes);
 
-    glEnableVertexAttribArray(6);
-    glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, m_Weights));
-    glBindVertexArray(0);
+    layout.apply();
+    glState.bindVertexArray(0);
 }
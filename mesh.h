@@ -9,6 +9,10 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "material.h"
+#include "memory_usage.h"
+#include "vertex_layout.h"
+
 class Shader;
 
 struct Vertex
@@ -23,11 +27,11 @@ struct Vertex
     float m_Weights[MAX_BONE_INFLUENCE];
 };
 
-struct Texture
+enum class MeshResidency
 {
-    unsigned int id;
-    std::string type;
-    std::string path;
+    KeepCPU,         // vertices and indices stay in memory after upload
+    DropAfterUpload, // only the GPU copy is kept
+    PositionsOnly    // positions and indices are kept for culling and picking
 };
 
 class Mesh
@@ -35,23 +39,56 @@ class Mesh
 public:
     std::vector<Vertex> vertices;
     std::vector<unsigned int> indices;
+    std::vector<glm::vec3> positions; // filled by the PositionsOnly policy
     std::vector<Texture> textures;
-    unsigned int VAO;
+    Material material;
+    VertexLayout layout;
+    GLenum indexType = GL_UNSIGNED_INT;
+    unsigned int indexCount = 0;
+    unsigned int vertexCount = 0;
+    unsigned int VAO = 0;
+
+    // object-space bounding box, kept under every residency policy
+    glm::vec3 boundsMin = glm::vec3(0.f);
+    glm::vec3 boundsMax = glm::vec3(0.f);
 
     Mesh(const std::vector<Vertex> &vertices,
          const std::vector<unsigned int> &indices,
-         const std::vector<Texture> &textures);
+         const std::vector<Texture> &textures,
+         const VertexLayout &layout = VertexLayout::make(VertexFormat::Full, true),
+         bool createBuffers = true);
 
     Mesh(std::vector<Vertex> &&vertices,
          std::vector<unsigned int> &&indices,
-         std::vector<Texture> &&textures);
+         std::vector<Texture> &&textures,
+         const VertexLayout &layout = VertexLayout::make(VertexFormat::Full, true),
+         bool createBuffers = true);
+
+    // uploads straight from arrays the caller owns (a mapped mesh cache) and
+    // copies only what the residency policy keeps on the CPU
+    Mesh(const Vertex *vertices, std::size_t vertexCount,
+         const unsigned int *indices, std::size_t indexCount,
+         std::vector<Texture> &&textures,
+         const VertexLayout &layout,
+         MeshResidency residency);
 
     void Draw(Shader &shader);
 
+    // frees the CPU copies the policy does not keep; call after every
+    // consumer of the vertex data (cache, batching) is done
+    void applyResidency(MeshResidency residency);
+
+    // textures are shared and reported by their owner
+    MemoryUsage memoryUsage() const;
+
 private:
-    unsigned int VBO, EBO;
+    unsigned int VBO = 0, EBO = 0;
+    std::size_t bufferBytes = 0;
 
-    void setupMesh();
+    // meshes drawn through a StaticBatch skip creating their own buffers
+    void setupMesh(bool createBuffers);
+    void setupMesh(const Vertex *vertexData, std::size_t vertexTotal,
+                   const unsigned int *indexData, std::size_t indexTotal, bool createBuffers);
 };
 
 #endif
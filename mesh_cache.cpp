@@ -0,0 +1,311 @@
+#include "mesh_cache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+    const char MAGIC[8] = {'A', 'P', 'M', 'E', 'S', 'H', '\0', '\0'};
+    const std::uint64_t BLOB_ALIGNMENT = 16;
+
+    struct FileHeader
+    {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t vertexSize;
+        std::uint32_t importFlags;
+        std::uint32_t meshCount;
+        std::int64_t sourceMtime;
+        std::uint32_t sourcePathLength;
+        std::uint32_t processFlags;
+    };
+
+    struct MeshRecord
+    {
+        std::uint64_t vertexOffset;
+        std::uint64_t vertexCount;
+        std::uint64_t indexOffset;
+        std::uint64_t indexCount;
+        std::uint32_t textureCount;
+        std::uint32_t flags;
+    };
+
+    const std::uint32_t MESH_SKINNED = 1;
+
+    struct TextureRecord
+    {
+        std::uint32_t type;
+        std::uint32_t pathLength;
+    };
+
+    std::uint64_t alignUp(std::uint64_t value)
+    {
+        return (value + BLOB_ALIGNMENT - 1) & ~(BLOB_ALIGNMENT - 1);
+    }
+
+    class Reader
+    {
+    public:
+        Reader(const char *data, std::size_t size) : data(data), size(size) {}
+
+        template <class T>
+        bool read(T &value)
+        {
+            if (size - offset < sizeof(T))
+                return false;
+            std::memcpy(&value, data + offset, sizeof(T));
+            offset += sizeof(T);
+            return true;
+        }
+
+        bool readString(std::string &value, std::size_t length)
+        {
+            if (size - offset < length)
+                return false;
+            value.assign(data + offset, length);
+            offset += length;
+            return true;
+        }
+
+        // count is checked against the room left rather than multiplied out,
+        // so a corrupt count cannot wrap past the end of the file
+        bool contains(std::uint64_t blobOffset, std::uint64_t count, std::size_t elementSize) const
+        {
+            return blobOffset % BLOB_ALIGNMENT == 0 && blobOffset <= size && count <= (size - blobOffset) / elementSize;
+        }
+
+        std::size_t remaining() const { return size - offset; }
+
+    private:
+        const char *data;
+        std::size_t size;
+        std::size_t offset = 0;
+    };
+}
+
+MeshCache::MeshCache(const std::string &sourcePath, unsigned int importFlags, unsigned int processFlags)
+    : sourcePath(sourcePath), importFlags(importFlags), processFlags(processFlags)
+{
+}
+
+MeshCache::~MeshCache()
+{
+    unmap();
+}
+
+bool MeshCache::sourceTime(std::int64_t &mtime) const
+{
+    std::error_code ec;
+    auto time = std::filesystem::last_write_time(sourcePath, ec);
+    if (ec)
+        return false;
+    mtime = static_cast<std::int64_t>(time.time_since_epoch().count());
+    return true;
+}
+
+void MeshCache::unmap()
+{
+    if (mapping)
+        munmap(mapping, mappingSize);
+    mapping = nullptr;
+    mappingSize = 0;
+    meshes.clear();
+}
+
+bool MeshCache::load()
+{
+    unmap();
+
+    std::int64_t mtime;
+    if (!sourceTime(mtime))
+        return false;
+
+    int fd = open(cachePath().c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(FileHeader))
+    {
+        close(fd);
+        return false;
+    }
+
+    void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return false;
+
+    mapping = data;
+    mappingSize = st.st_size;
+
+    const char *base = static_cast<const char *>(mapping);
+    Reader reader(base, mappingSize);
+
+    FileHeader header;
+    std::string storedPath;
+    if (!reader.read(header) ||
+        std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        header.version != VERSION ||
+        header.vertexSize != sizeof(Vertex) ||
+        header.importFlags != importFlags ||
+        header.processFlags != processFlags ||
+        header.sourceMtime != mtime ||
+        !reader.readString(storedPath, header.sourcePathLength) ||
+        storedPath != sourcePath ||
+        header.meshCount > reader.remaining() / sizeof(MeshRecord))
+    {
+        unmap();
+        return false;
+    }
+
+    meshes.reserve(header.meshCount);
+    for (std::uint32_t i = 0; i < header.meshCount; ++i)
+    {
+        MeshRecord record;
+        if (!reader.read(record) ||
+            !reader.contains(record.vertexOffset, record.vertexCount, sizeof(Vertex)) ||
+            !reader.contains(record.indexOffset, record.indexCount, sizeof(unsigned int)))
+        {
+            unmap();
+            return false;
+        }
+
+        CachedMesh mesh;
+        mesh.vertices = reinterpret_cast<const Vertex *>(base + record.vertexOffset);
+        mesh.vertexCount = record.vertexCount;
+        mesh.indices = reinterpret_cast<const unsigned int *>(base + record.indexOffset);
+        mesh.indexCount = record.indexCount;
+        mesh.skinned = (record.flags & MESH_SKINNED) != 0;
+
+        for (std::uint32_t t = 0; t < record.textureCount; ++t)
+        {
+            TextureRecord textureRecord;
+            CachedTexture texture;
+            if (!reader.read(textureRecord) ||
+                textureRecord.type > static_cast<std::uint32_t>(TextureType::Height) ||
+                !reader.readString(texture.path, textureRecord.pathLength))
+            {
+                unmap();
+                return false;
+            }
+            texture.type = static_cast<TextureType>(textureRecord.type);
+            mesh.textures.push_back(std::move(texture));
+        }
+
+        meshes.push_back(std::move(mesh));
+    }
+
+    return true;
+}
+
+bool MeshCache::write(const std::vector<Mesh> &meshes) const
+{
+    std::int64_t mtime;
+    if (!sourceTime(mtime))
+        return false;
+
+    FileHeader header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.vertexSize = sizeof(Vertex);
+    header.importFlags = importFlags;
+    header.meshCount = static_cast<std::uint32_t>(meshes.size());
+    header.sourceMtime = mtime;
+    header.sourcePathLength = static_cast<std::uint32_t>(sourcePath.size());
+    header.processFlags = processFlags;
+
+    // texture files relative to the model so the cache survives a move
+    std::error_code ec;
+    const std::filesystem::path modelDirectory = std::filesystem::weakly_canonical(
+        std::filesystem::absolute(std::filesystem::path(sourcePath).parent_path()), ec);
+
+    std::vector<std::vector<std::string>> texturePaths(meshes.size());
+    std::uint64_t directorySize = sizeof(FileHeader) + sourcePath.size();
+    for (std::size_t i = 0; i < meshes.size(); ++i)
+    {
+        directorySize += sizeof(MeshRecord);
+        for (const Texture &texture : meshes[i].textures)
+        {
+            std::string path = ec ? std::string() : std::filesystem::path(texture.resource->path).lexically_relative(modelDirectory).generic_string();
+            if (path.empty())
+                path = texture.resource->path;
+            directorySize += sizeof(TextureRecord) + path.size();
+            texturePaths[i].push_back(std::move(path));
+        }
+    }
+
+    std::vector<MeshRecord> records(meshes.size());
+    std::uint64_t offset = alignUp(directorySize);
+    for (std::size_t i = 0; i < meshes.size(); ++i)
+    {
+        records[i] = {};
+        records[i].vertexOffset = offset;
+        records[i].vertexCount = meshes[i].vertices.size();
+        offset = alignUp(offset + records[i].vertexCount * sizeof(Vertex));
+
+        records[i].indexOffset = offset;
+        records[i].indexCount = meshes[i].indices.size();
+        offset = alignUp(offset + records[i].indexCount * sizeof(unsigned int));
+
+        records[i].textureCount = static_cast<std::uint32_t>(meshes[i].textures.size());
+        records[i].flags = meshes[i].layout.skinned ? MESH_SKINNED : 0;
+    }
+
+    const std::string tmpPath = cachePath() + ".tmp";
+    std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        std::cerr << "\n[Mesh cache not writable] " << tmpPath << '\n';
+        return false;
+    }
+
+    auto pad = [&file]()
+    {
+        static const char zeros[BLOB_ALIGNMENT] = {};
+        std::uint64_t position = static_cast<std::uint64_t>(file.tellp());
+        file.write(zeros, alignUp(position) - position);
+    };
+
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(sourcePath.data(), sourcePath.size());
+
+    for (std::size_t i = 0; i < meshes.size(); ++i)
+    {
+        file.write(reinterpret_cast<const char *>(&records[i]), sizeof(MeshRecord));
+        for (std::size_t t = 0; t < meshes[i].textures.size(); ++t)
+        {
+            const std::string &path = texturePaths[i][t];
+            TextureRecord textureRecord = {static_cast<std::uint32_t>(meshes[i].textures[t].type),
+                                           static_cast<std::uint32_t>(path.size())};
+            file.write(reinterpret_cast<const char *>(&textureRecord), sizeof(textureRecord));
+            file.write(path.data(), path.size());
+        }
+    }
+
+    for (const Mesh &mesh : meshes)
+    {
+        pad();
+        file.write(reinterpret_cast<const char *>(mesh.vertices.data()), mesh.vertices.size() * sizeof(Vertex));
+        pad();
+        file.write(reinterpret_cast<const char *>(mesh.indices.data()), mesh.indices.size() * sizeof(unsigned int));
+    }
+
+    file.close();
+    if (!file || std::rename(tmpPath.c_str(), cachePath().c_str()) != 0)
+    {
+        std::cerr << "\n[Mesh cache write failed] " << cachePath() << '\n';
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+
+    return true;
+}
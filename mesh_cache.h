@@ -0,0 +1,67 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mesh.h"
+
+// Binary cache of fully processed meshes, stored next to the source model
+// as "<source>.meshcache". The file is memory-mapped on load, so vertex and
+// index data are read straight from the page cache.
+
+struct CachedTexture
+{
+    TextureType type;
+    std::string path; // relative to the model's directory when possible
+};
+
+struct CachedMesh
+{
+    const Vertex *vertices;
+    std::size_t vertexCount;
+    const unsigned int *indices;
+    std::size_t indexCount;
+    bool skinned;
+    std::vector<CachedTexture> textures;
+};
+
+class MeshCache
+{
+public:
+    static const std::uint32_t VERSION = 5;
+
+    // post-import processing applied to the cached meshes (processFlags bits)
+    static const std::uint32_t PROCESS_OPTIMIZED = 1;
+    static const std::uint32_t PROCESS_NORMAL_MODE_SHIFT = 1; // NormalMode in bits 1-3
+
+    MeshCache(const std::string &sourcePath, unsigned int importFlags, unsigned int processFlags = 0);
+    ~MeshCache();
+
+    MeshCache(const MeshCache &) = delete;
+    MeshCache &operator=(const MeshCache &) = delete;
+
+    // maps the cache file; false if it is missing, corrupt or stale
+    bool load();
+
+    const std::vector<CachedMesh> &getMeshes() const { return meshes; }
+
+    bool write(const std::vector<Mesh> &meshes) const;
+
+    std::string cachePath() const { return sourcePath + ".meshcache"; }
+
+private:
+    std::string sourcePath;
+    unsigned int importFlags;
+    unsigned int processFlags;
+
+    void *mapping = nullptr;
+    std::size_t mappingSize = 0;
+    std::vector<CachedMesh> meshes;
+
+    bool sourceTime(std::int64_t &mtime) const;
+    void unmap();
+};
+
+#endif
@@ -0,0 +1,371 @@
+#include "mesh_optimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+
+namespace
+{
+    struct VertexHash
+    {
+        const std::vector<Vertex> *vertices;
+
+        std::size_t operator()(unsigned int index) const
+        {
+            // FNV-1a over the raw vertex; Vertex has no padding
+            const unsigned char *bytes = reinterpret_cast<const unsigned char *>(&(*vertices)[index]);
+            std::uint64_t hash = 14695981039346656037ull;
+            for (std::size_t i = 0; i < sizeof(Vertex); ++i)
+                hash = (hash ^ bytes[i]) * 1099511628211ull;
+            return static_cast<std::size_t>(hash);
+        }
+    };
+
+    struct VertexEqual
+    {
+        const std::vector<Vertex> *vertices;
+
+        bool operator()(unsigned int a, unsigned int b) const
+        {
+            return std::memcmp(&(*vertices)[a], &(*vertices)[b], sizeof(Vertex)) == 0;
+        }
+    };
+
+    void deduplicateVertices(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices)
+    {
+        std::unordered_map<unsigned int, unsigned int, VertexHash, VertexEqual> unique(
+            vertices.size(), VertexHash{&vertices}, VertexEqual{&vertices});
+
+        std::vector<unsigned int> remap(vertices.size());
+        unsigned int uniqueCount = 0;
+        for (unsigned int i = 0; i < vertices.size(); ++i)
+        {
+            auto inserted = unique.emplace(i, uniqueCount);
+            if (inserted.second)
+                uniqueCount++;
+            remap[i] = inserted.first->second;
+        }
+
+        if (uniqueCount == vertices.size())
+            return;
+
+        std::vector<Vertex> compacted(uniqueCount);
+        for (unsigned int i = 0; i < vertices.size(); ++i)
+            compacted[remap[i]] = vertices[i];
+
+        for (unsigned int &index : indices)
+            index = remap[index];
+        vertices.swap(compacted);
+    }
+
+    // Tom Forsyth, "Linear-Speed Vertex Cache Optimisation" (2006)
+    const float CACHE_DECAY_POWER = 1.5f;
+    const float LAST_TRIANGLE_SCORE = 0.75f;
+    const float VALENCE_BOOST_SCALE = 2.0f;
+    const float VALENCE_BOOST_POWER = 0.5f;
+
+    float vertexScore(int cachePosition, unsigned int activeTriangles)
+    {
+        if (activeTriangles == 0)
+            return -1.f;
+
+        float score = 0.f;
+        if (cachePosition >= 0)
+        {
+            if (cachePosition < 3)
+                score = LAST_TRIANGLE_SCORE;
+            else
+            {
+                const float scaler = 1.f / (VERTEX_CACHE_SIZE - 3);
+                score = std::pow(1.f - (cachePosition - 3) * scaler, CACHE_DECAY_POWER);
+            }
+        }
+
+        return score + VALENCE_BOOST_SCALE * std::pow(static_cast<float>(activeTriangles), -VALENCE_BOOST_POWER);
+    }
+
+    void optimizeVertexCache(std::vector<unsigned int> &indices, std::size_t vertexCount)
+    {
+        const std::size_t triangleCount = indices.size() / 3;
+        if (triangleCount == 0)
+            return;
+
+        // per-vertex lists of triangles that are not emitted yet
+        std::vector<unsigned int> activeCount(vertexCount, 0);
+        for (unsigned int index : indices)
+            activeCount[index]++;
+
+        std::vector<unsigned int> adjacencyOffset(vertexCount + 1, 0);
+        for (std::size_t v = 0; v < vertexCount; ++v)
+            adjacencyOffset[v + 1] = adjacencyOffset[v] + activeCount[v];
+
+        std::vector<unsigned int> adjacency(indices.size());
+        std::vector<unsigned int> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+        for (std::size_t t = 0; t < triangleCount; ++t)
+            for (int k = 0; k < 3; ++k)
+                adjacency[fill[indices[t * 3 + k]]++] = static_cast<unsigned int>(t);
+
+        std::vector<int> cachePosition(vertexCount, -1);
+        std::vector<float> score(vertexCount);
+        for (std::size_t v = 0; v < vertexCount; ++v)
+            score[v] = vertexScore(-1, activeCount[v]);
+
+        std::vector<float> triangleScore(triangleCount);
+        std::vector<bool> emitted(triangleCount, false);
+        for (std::size_t t = 0; t < triangleCount; ++t)
+            triangleScore[t] = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+
+        std::vector<unsigned int> cache, nextCache;
+        cache.reserve(VERTEX_CACHE_SIZE + 3);
+        nextCache.reserve(VERTEX_CACHE_SIZE + 3);
+
+        std::vector<unsigned int> result;
+        result.reserve(indices.size());
+
+        std::size_t scanCursor = 0;
+        long bestTriangle = std::max_element(triangleScore.begin(), triangleScore.end()) - triangleScore.begin();
+
+        while (bestTriangle >= 0)
+        {
+            const unsigned int *triangle = &indices[bestTriangle * 3];
+            emitted[bestTriangle] = true;
+            result.insert(result.end(), triangle, triangle + 3);
+
+            nextCache.assign(triangle, triangle + 3);
+            for (unsigned int v : cache)
+                if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+                    nextCache.push_back(v);
+
+            for (int k = 0; k < 3; ++k)
+            {
+                const unsigned int v = triangle[k];
+                unsigned int *begin = &adjacency[adjacencyOffset[v]];
+                unsigned int *end = begin + activeCount[v];
+                *std::find(begin, end, static_cast<unsigned int>(bestTriangle)) = *(end - 1);
+                activeCount[v]--;
+            }
+
+            for (std::size_t i = 0; i < nextCache.size(); ++i)
+            {
+                const unsigned int v = nextCache[i];
+                cachePosition[v] = i < VERTEX_CACHE_SIZE ? static_cast<int>(i) : -1;
+                score[v] = vertexScore(cachePosition[v], activeCount[v]);
+            }
+
+            bestTriangle = -1;
+            float bestScore = -1.f;
+            for (unsigned int v : nextCache)
+            {
+                for (unsigned int a = 0; a < activeCount[v]; ++a)
+                {
+                    const unsigned int t = adjacency[adjacencyOffset[v] + a];
+                    triangleScore[t] = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+                    if (triangleScore[t] > bestScore)
+                    {
+                        bestScore = triangleScore[t];
+                        bestTriangle = t;
+                    }
+                }
+            }
+
+            if (nextCache.size() > VERTEX_CACHE_SIZE)
+                nextCache.resize(VERTEX_CACHE_SIZE);
+            cache.swap(nextCache);
+
+            // nothing left around the cache: restart from the next unemitted triangle
+            if (bestTriangle < 0)
+            {
+                while (scanCursor < triangleCount && emitted[scanCursor])
+                    scanCursor++;
+                if (scanCursor < triangleCount)
+                    bestTriangle = static_cast<long>(scanCursor);
+            }
+        }
+
+        indices.swap(result);
+    }
+
+    // Splits the cache-ordered list where the FIFO cache starts over (a
+    // triangle with three misses) and draws outward-facing clusters first,
+    // so that they occlude the rest of the mesh. The cache order inside each
+    // cluster is preserved, so ACMR is not affected.
+    void optimizeOverdraw(std::vector<unsigned int> &indices, const std::vector<Vertex> &vertices)
+    {
+        const std::size_t triangleCount = indices.size() / 3;
+        if (triangleCount == 0)
+            return;
+
+        std::vector<std::size_t> clusterStart;
+        std::vector<unsigned int> cacheTime(vertices.size(), 0);
+        unsigned int time = VERTEX_CACHE_SIZE + 1;
+        for (std::size_t t = 0; t < triangleCount; ++t)
+        {
+            int misses = 0;
+            for (int k = 0; k < 3; ++k)
+            {
+                const unsigned int v = indices[t * 3 + k];
+                if (time - cacheTime[v] > VERTEX_CACHE_SIZE)
+                {
+                    cacheTime[v] = time++;
+                    misses++;
+                }
+            }
+            if (t == 0 || misses == 3)
+                clusterStart.push_back(t);
+        }
+        if (clusterStart.size() < 2)
+            return;
+        clusterStart.push_back(triangleCount);
+
+        glm::vec3 meshCentroid(0.f);
+        for (const Vertex &vertex : vertices)
+            meshCentroid += vertex.Position;
+        meshCentroid /= static_cast<float>(vertices.size());
+
+        const std::size_t clusterCount = clusterStart.size() - 1;
+        std::vector<float> sortKey(clusterCount);
+        for (std::size_t c = 0; c < clusterCount; ++c)
+        {
+            glm::vec3 centroid(0.f), normal(0.f);
+            float area = 0.f;
+            for (std::size_t t = clusterStart[c]; t < clusterStart[c + 1]; ++t)
+            {
+                const glm::vec3 &p0 = vertices[indices[t * 3]].Position;
+                const glm::vec3 &p1 = vertices[indices[t * 3 + 1]].Position;
+                const glm::vec3 &p2 = vertices[indices[t * 3 + 2]].Position;
+                const glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+                const float a = glm::length(n);
+
+                centroid += (p0 + p1 + p2) * (a / 3.f);
+                normal += n;
+                area += a;
+            }
+
+            const float normalLength = glm::length(normal);
+            if (area > 0.f && normalLength > 0.f)
+                sortKey[c] = glm::dot(centroid / area - meshCentroid, normal / normalLength);
+            else
+                sortKey[c] = 0.f;
+        }
+
+        std::vector<std::size_t> order(clusterCount);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(),
+                         [&sortKey](std::size_t a, std::size_t b) { return sortKey[a] > sortKey[b]; });
+
+        std::vector<unsigned int> result;
+        result.reserve(indices.size());
+        for (std::size_t c : order)
+            result.insert(result.end(), indices.begin() + clusterStart[c] * 3, indices.begin() + clusterStart[c + 1] * 3);
+        indices.swap(result);
+    }
+
+    void optimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices)
+    {
+        const unsigned int UNUSED = ~0u;
+        std::vector<unsigned int> remap(vertices.size(), UNUSED);
+        std::vector<Vertex> ordered;
+        ordered.reserve(vertices.size());
+
+        for (unsigned int &index : indices)
+        {
+            if (remap[index] == UNUSED)
+            {
+                remap[index] = static_cast<unsigned int>(ordered.size());
+                ordered.push_back(vertices[index]);
+            }
+            index = remap[index];
+        }
+
+        // vertices no triangle references are dropped
+        vertices.swap(ordered);
+    }
+}
+
+MeshOptimizeStats &MeshOptimizeStats::operator+=(const MeshOptimizeStats &other)
+{
+    const std::size_t total = triangles + other.triangles;
+    if (total > 0)
+    {
+        acmrBefore = (acmrBefore * triangles + other.acmrBefore * other.triangles) / total;
+        acmrAfter = (acmrAfter * triangles + other.acmrAfter * other.triangles) / total;
+    }
+    triangles = total;
+    verticesBefore += other.verticesBefore;
+    verticesAfter += other.verticesAfter;
+    return *this;
+}
+
+float computeACMR(const std::vector<unsigned int> &indices, std::size_t vertexCount, unsigned int cacheSize)
+{
+    const std::size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return 0.f;
+
+    std::vector<unsigned int> cacheTime(vertexCount, 0);
+    unsigned int time = cacheSize + 1;
+    std::size_t misses = 0;
+    for (unsigned int index : indices)
+    {
+        if (time - cacheTime[index] > cacheSize)
+        {
+            cacheTime[index] = time++;
+            misses++;
+        }
+    }
+
+    return static_cast<float>(misses) / triangleCount;
+}
+
+void optimizeMesh(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices, MeshOptimizeStats *stats)
+{
+    if (stats)
+    {
+        stats->triangles = indices.size() / 3;
+        stats->verticesBefore = vertices.size();
+        stats->acmrBefore = computeACMR(indices, vertices.size());
+    }
+
+    deduplicateVertices(vertices, indices);
+    optimizeVertexCache(indices, vertices.size());
+    optimizeOverdraw(indices, vertices);
+    optimizeVertexFetch(vertices, indices);
+
+    if (stats)
+    {
+        stats->verticesAfter = vertices.size();
+        stats->acmrAfter = computeACMR(indices, vertices.size());
+    }
+}
+
+GLenum selectIndexType(std::size_t vertexCount)
+{
+    return vertexCount <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+std::size_t indexSize(GLenum type)
+{
+    return type == GL_UNSIGNED_SHORT ? sizeof(std::uint16_t) : sizeof(std::uint32_t);
+}
+
+void packIndices(const std::vector<unsigned int> &indices, GLenum type, std::vector<unsigned char> &out)
+{
+    packIndices(indices.data(), indices.size(), type, out);
+}
+
+void packIndices(const unsigned int *indices, std::size_t count, GLenum type, std::vector<unsigned char> &out)
+{
+    out.resize(count * indexSize(type));
+    if (type == GL_UNSIGNED_INT)
+    {
+        std::memcpy(out.data(), indices, out.size());
+        return;
+    }
+
+    std::uint16_t *shorts = reinterpret_cast<std::uint16_t *>(out.data());
+    for (std::size_t i = 0; i < count; ++i)
+        shorts[i] = static_cast<std::uint16_t>(indices[i]);
+}
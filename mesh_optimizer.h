@@ -0,0 +1,41 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+#include <cstddef>
+#include <vector>
+#include <glad/glad.h>
+
+#include "mesh.h"
+
+// Import-time optimization of indexed triangle lists: identical vertices are
+// merged, triangles are reordered for the post-transform vertex cache
+// (Forsyth) and then, cluster by cluster, for overdraw, and finally the
+// vertex buffer is reordered to match the order in which it is fetched.
+
+struct MeshOptimizeStats
+{
+    std::size_t triangles = 0;
+    std::size_t verticesBefore = 0;
+    std::size_t verticesAfter = 0;
+    float acmrBefore = 0.f;
+    float acmrAfter = 0.f;
+
+    MeshOptimizeStats &operator+=(const MeshOptimizeStats &other);
+};
+
+const unsigned int VERTEX_CACHE_SIZE = 32;
+
+// average cache miss ratio (transformed vertices per triangle) of a FIFO
+// post-transform cache; 3 is the worst case, ~0.5 the best for grids
+float computeACMR(const std::vector<unsigned int> &indices, std::size_t vertexCount, unsigned int cacheSize = VERTEX_CACHE_SIZE);
+
+void optimizeMesh(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices, MeshOptimizeStats *stats = nullptr);
+
+// GL_UNSIGNED_SHORT when every index fits in 16 bits, GL_UNSIGNED_INT otherwise
+GLenum selectIndexType(std::size_t vertexCount);
+
+std::size_t indexSize(GLenum type);
+
+void packIndices(const std::vector<unsigned int> &indices, GLenum type, std::vector<unsigned char> &out);
+void packIndices(const unsigned int *indices, std::size_t count, GLenum type, std::vector<unsigned char> &out);
+
+#endif
@@ -2,26 +2,151 @@
 #include "shader.h"
 #include "model.h"
 #include "mesh.h"
+#include "render_queue.h"
+#include "texture_loader.h"
+#include "thread_pool.h"
 
+#include <algorithm>
+#include <filesystem>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 
 Model::Model(std::string const &path, bool gamma) : gammaCorrection(gamma)
+{
+    options.gamma = gamma;
+    loadModel(path);
+}
+
+Model::Model(std::string const &path, const ModelOptions &options) : gammaCorrection(options.gamma), options(options)
 {
     loadModel(path);
 }
 
 void Model::Draw(Shader &shader)
 {
+    if (!batch.empty())
+    {
+        batch.Draw(shader);
+        return;
+    }
+
     for (unsigned int i = 0; i < meshes.size(); i++)
         meshes[i].Draw(shader);
 }
 
+std::size_t Model::drawableCount() const
+{
+    return batch.empty() ? meshes.size() : batch.groupCount();
+}
+
+void Model::collectPackets(std::size_t begin, std::size_t end, const DrawPacket &prototype,
+                           const Frustum &frustum, std::vector<DrawPacket> &out) const
+{
+    if (!batch.empty())
+    {
+        batch.collectPackets(begin, end, prototype, frustum, out);
+        return;
+    }
+
+    for (std::size_t i = begin; i < end; ++i)
+    {
+        const Mesh &mesh = meshes[i];
+        if (!frustum.intersects(mesh.boundsMin, mesh.boundsMax))
+            continue;
+
+        DrawPacket packet = prototype;
+        packet.material = &mesh.material;
+        packet.VAO = mesh.VAO;
+        packet.center = (mesh.boundsMin + mesh.boundsMax) * 0.5f;
+        packet.count = static_cast<GLsizei>(mesh.indexCount);
+        packet.indexType = mesh.indexType;
+        out.push_back(packet);
+    }
+}
+
 void Model::loadModel(std::string const &path)
 {
+    directory = path.substr(0, path.find_last_of('/'));
+
+    TextureLoader loader(ThreadPool::shared());
+    textureLoader = &loader;
+    importModel(path);
+    loader.finish();
+    textureLoader = nullptr;
+
+    if (options.batched && !meshes.empty())
+        batch.build(meshes);
+
+    for (Mesh &mesh : meshes)
+        mesh.applyResidency(options.residency);
+}
+
+std::vector<TextureHandle> Model::referencedTextures() const
+{
+    std::vector<TextureHandle> textures;
+    for (const Mesh &mesh : meshes)
+        for (const Texture &texture : mesh.textures)
+            if (std::find(textures.begin(), textures.end(), texture.resource) == textures.end())
+                textures.push_back(texture.resource);
+    return textures;
+}
+
+bool Model::hasTexture(TextureType type) const
+{
+    for (const Mesh &mesh : meshes)
+        for (const Texture &texture : mesh.textures)
+            if (texture.type == type)
+                return true;
+    return false;
+}
+
+MemoryUsage Model::memoryUsage() const
+{
+    MemoryUsage usage;
+    for (const Mesh &mesh : meshes)
+        usage += mesh.memoryUsage();
+    usage += batch.memoryUsage();
+
+    for (const TextureHandle &texture : referencedTextures())
+    {
+        usage.cpuBytes += sizeof(TextureResource) + texture->path.capacity();
+        usage.gpuBytes += textureGpuBytes(texture->id);
+    }
+    return usage;
+}
+
+void Model::printMemoryReport(std::ostream &os) const
+{
+    os << "\n[Memory] " << directory << ": " << memoryUsage() << '\n';
+
+    for (std::size_t i = 0; i < meshes.size(); ++i)
+        os << "  mesh " << i << " (" << meshes[i].vertexCount << " vertices): " << meshes[i].memoryUsage() << '\n';
+
+    if (!batch.empty())
+        os << "  batch: " << batch.memoryUsage() << '\n';
+
+    for (const TextureHandle &texture : referencedTextures())
+    {
+        MemoryUsage usage;
+        usage.cpuBytes = sizeof(TextureResource) + texture->path.capacity();
+        usage.gpuBytes = textureGpuBytes(texture->id);
+        os << "  texture " << texture->path << ": " << usage << '\n';
+    }
+}
+
+void Model::importModel(std::string const &path)
+{
+    const unsigned int importFlags = aiProcess_Triangulate | aiProcess_CalcTangentSpace;
+    const unsigned int processFlags = (options.optimize ? MeshCache::PROCESS_OPTIMIZED : 0) |
+                                      static_cast<unsigned int>(options.normalMode) << MeshCache::PROCESS_NORMAL_MODE_SHIFT;
+
+    MeshCache cache(path, importFlags, processFlags);
+    if (loadFromCache(cache))
+        return;
+
     Assimp::Importer importer;
-    const aiScene *scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_CalcTangentSpace);
+    const aiScene *scene = importer.ReadFile(path, importFlags);
 
     if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
     {
@@ -29,8 +154,43 @@ void Model::loadModel(std::string const &path)
         return;
     }
 
-    directory = path.substr(0, path.find_last_of('/'));
+    MeshOptimizeStats stats;
+    optimizeStats = &stats;
     processNode(scene->mRootNode, scene);
+    optimizeStats = nullptr;
+
+    if (options.optimize)
+        std::cout << "\n[Mesh optimizer] " << path
+                  << " vertices " << stats.verticesBefore << " -> " << stats.verticesAfter
+                  << ", ACMR " << stats.acmrBefore << " -> " << stats.acmrAfter << '\n';
+
+    cache.write(meshes);
+}
+
+bool Model::loadFromCache(MeshCache &cache)
+{
+    if (!cache.load())
+        return false;
+
+    meshes.reserve(cache.getMeshes().size());
+    for (const CachedMesh &cached : cache.getMeshes())
+    {
+        std::vector<Texture> textures;
+        for (const CachedTexture &texture : cached.textures)
+            textures.push_back(loadTexture(texture.path, texture.type));
+
+        // normals were generated before the cache was written; a static
+        // batch packs from the CPU vertices, so only batched models copy
+        const VertexLayout layout = VertexLayout::make(options.vertexFormat, cached.skinned);
+        if (options.batched)
+            meshes.emplace_back(std::vector<Vertex>(cached.vertices, cached.vertices + cached.vertexCount),
+                                std::vector<unsigned int>(cached.indices, cached.indices + cached.indexCount),
+                                std::move(textures), layout, false);
+        else
+            meshes.emplace_back(cached.vertices, cached.vertexCount, cached.indices, cached.indexCount,
+                                std::move(textures), layout, options.residency);
+    }
+    return true;
 }
 
 void Model::processNode(aiNode *node, const aiScene *scene)
@@ -63,10 +223,15 @@ Mesh Model::processMesh(aiMesh *mesh, const aiScene *scene)
         vector.z = mesh->mVertices[i].z;
         vertex.Position = vector;
 
-        vector.x = mesh->mNormals[i].x;
-        vector.y = mesh->mNormals[i].y;
-        vector.z = mesh->mNormals[i].z;
-        vertex.Normal = vector;
+        if (mesh->HasNormals())
+        {
+            vector.x = mesh->mNormals[i].x;
+            vector.y = mesh->mNormals[i].y;
+            vector.z = mesh->mNormals[i].z;
+            vertex.Normal = vector;
+        }
+        else
+            vertex.Normal = glm::vec3(0.0f, 0.0f, 0.0f);
 
         if (mesh->mTextureCoords[0])
         {
@@ -87,6 +252,12 @@ Mesh Model::processMesh(aiMesh *mesh, const aiScene *scene)
         vector.y = mesh->mBitangents[i].y;
         vector.z = mesh->mBitangents[i].z;
         vertex.Bitangent = vector;
+
+        for (int j = 0; j < MAX_BONE_INFLUENCE; j++)
+        {
+            vertex.m_BoneIDs[j] = 0;
+            vertex.m_Weights[j] = 0.0f;
+        }
         vertices.push_back(vertex);
     }
 
@@ -100,52 +271,70 @@ Mesh Model::processMesh(aiMesh *mesh, const aiScene *scene)
 
     aiMaterial *material = scene->mMaterials[mesh->mMaterialIndex];
 
-    std::vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
+    std::vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, TextureType::Diffuse);
     textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
 
-    std::vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
+    std::vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, TextureType::Specular);
     textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
 
-    std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
+    std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, TextureType::Normal);
     textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
 
-    std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
+    std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, TextureType::Height);
     textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
 
-    return Mesh(std::move(vertices), std::move(indices), std::move(textures));
+    // normals are generated before optimizing so that only vertices with
+    // the same final normal get merged
+    NormalMode normalMode = options.normalMode;
+    if (normalMode == NormalMode::Imported && !mesh->HasNormals())
+        normalMode = NormalMode::SmoothAngle;
+    generateNormals(vertices, indices, normalMode, ThreadPool::shared());
+
+    if (options.optimize)
+    {
+        MeshOptimizeStats stats;
+        optimizeMesh(vertices, indices, &stats);
+        *optimizeStats += stats;
+    }
+
+    return Mesh(std::move(vertices), std::move(indices), std::move(textures),
+                VertexLayout::make(options.vertexFormat, mesh->HasBones()),
+                !options.batched);
 }
 
-std::vector<Texture> Model::loadMaterialTextures(aiMaterial *mat, aiTextureType type, std::string typeName)
+std::vector<Texture> Model::loadMaterialTextures(aiMaterial *mat, aiTextureType type, TextureType textureType)
 {
     std::vector<Texture> textures;
     for (unsigned int i = 0; i < mat->GetTextureCount(type); i++)
     {
         aiString str;
         mat->GetTexture(type, i, &str);
-
-        bool skip = false;
-        for (unsigned int j = 0; j < textures_loaded.size(); j++)
-        {
-            if (std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-            {
-                textures.push_back(textures_loaded[j]);
-                skip = true;
-                break;
-            }
-        }
-        if (!skip)
-        {
-            Texture texture;
-            texture.id = TextureFromFile(str.C_Str(), this->directory);
-            texture.type = typeName;
-            texture.path = str.C_Str();
-            textures.push_back(texture);
-            textures_loaded.push_back(texture);
-        }
+        textures.push_back(loadTexture(str.C_Str(), textureType));
     }
     return textures;
 }
 
+Texture Model::loadTexture(const std::string &path, TextureType type)
+{
+    const std::string filename = std::filesystem::path(path).is_absolute() ? path : this->directory + '/' + path;
+
+    // only colour maps are stored in sRGB; normal, specular and height maps
+    // hold linear data
+    const bool gamma = options.gamma && type == TextureType::Diffuse;
+
+    bool created;
+    Texture texture;
+    texture.resource = TextureRegistry::instance().acquire(filename, gamma, created);
+    texture.id = texture.resource->id;
+    texture.type = type;
+
+    // decoded and uploaded only by the first model that references it
+    if (created)
+        textureLoader->enqueue(texture.id, texture.resource->path, gamma);
+
+    return texture;
+}
+
 unsigned int TextureFromFile(const char *path, const std::string &directory, bool gamma)
 {
     std::string filename = std::string(path);
@@ -154,34 +343,11 @@ unsigned int TextureFromFile(const char *path, const std::string &directory, boo
     unsigned int textureID;
     glGenTextures(1, &textureID);
 
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-    if (data)
-    {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    }
+    DecodedImage image;
+    if (decodeImage(filename, image))
+        uploadTexture2D(textureID, image, gamma);
     else
-    {
         std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-    }
 
     return textureID;
 }
@@ -1,6 +1,7 @@
 // http://learnopengl.com/
 #ifndef MODEL_H
 #define MODEL_H
+#include <ostream>
 #include <vector>
 #include <string>
 #include <glad/glad.h>
@@ -13,31 +14,79 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include "mesh.h"
+#include "mesh_cache.h"
+#include "mesh_optimizer.h"
+#include "normal_generator.h"
+#include "static_batch.h"
 
+struct DrawPacket;
+struct Frustum;
 class Shader;
+class TextureLoader;
 
 unsigned int TextureFromFile(const char *path, const std::string &directory, bool gamma = false);
 
+struct ModelOptions
+{
+    bool gamma = false;
+    VertexFormat vertexFormat = VertexFormat::Full;
+    bool batched = false;  // draw all meshes through one StaticBatch
+    bool optimize = false; // run the mesh optimizer on import
+    NormalMode normalMode = NormalMode::Faceted;
+    MeshResidency residency = MeshResidency::KeepCPU;
+};
+
 class Model
 {
 public:
-    std::vector<Texture> textures_loaded;
     std::vector<Mesh> meshes;
     std::string directory;
     bool gammaCorrection;
+    ModelOptions options;
 
     Model(std::string const &path, bool gamma = false);
 
+    Model(std::string const &path, const ModelOptions &options);
+
     void Draw(Shader &shader);
 
+    // meshes, or batch groups when batched
+    std::size_t drawableCount() const;
+
+    // appends a copy of the prototype for every drawable in [begin, end)
+    // whose bounds intersect the frustum; makes no GL calls
+    void collectPackets(std::size_t begin, std::size_t end, const DrawPacket &prototype,
+                        const Frustum &frustum, std::vector<DrawPacket> &out) const;
+
+    // meshes, batch and the textures this model references; shared
+    // textures are counted by every model that uses them
+    MemoryUsage memoryUsage() const;
+
+    void printMemoryReport(std::ostream &os) const;
+
+    // true if any mesh uses a texture of this type
+    bool hasTexture(TextureType type) const;
+
 private:
+    TextureLoader *textureLoader = nullptr;
+    MeshOptimizeStats *optimizeStats = nullptr;
+    StaticBatch batch;
+
     void loadModel(std::string const &path);
 
+    void importModel(std::string const &path);
+
     void processNode(aiNode *node, const aiScene *scene);
 
     Mesh processMesh(aiMesh *mesh, const aiScene *scene);
 
-    std::vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, std::string typeName);
+    bool loadFromCache(MeshCache &cache);
+
+    std::vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, TextureType textureType);
+
+    Texture loadTexture(const std::string &path, TextureType type);
+
+    std::vector<TextureHandle> referencedTextures() const;
 };
 
 #endif
@@ -0,0 +1,204 @@
+#include "normal_generator.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    const std::size_t TRIANGLE_GRAIN = 4096;
+    const std::size_t VERTEX_GRAIN = 8192;
+
+    // unnormalized face normals (length is twice the area) of triangles [begin, end)
+    void faceNormals(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices,
+                     std::size_t begin, std::size_t end, glm::vec3 *out)
+    {
+        std::size_t t = begin;
+#ifdef __SSE2__
+        for (; t + 4 <= end; t += 4)
+        {
+            // four triangles at a time, one coordinate per register
+            __m128 p[3][3];
+            for (int corner = 0; corner < 3; ++corner)
+            {
+                const glm::vec3 &a = vertices[indices[(t + 0) * 3 + corner]].Position;
+                const glm::vec3 &b = vertices[indices[(t + 1) * 3 + corner]].Position;
+                const glm::vec3 &c = vertices[indices[(t + 2) * 3 + corner]].Position;
+                const glm::vec3 &d = vertices[indices[(t + 3) * 3 + corner]].Position;
+                p[corner][0] = _mm_setr_ps(a.x, b.x, c.x, d.x);
+                p[corner][1] = _mm_setr_ps(a.y, b.y, c.y, d.y);
+                p[corner][2] = _mm_setr_ps(a.z, b.z, c.z, d.z);
+            }
+
+            const __m128 e1x = _mm_sub_ps(p[1][0], p[0][0]), e2x = _mm_sub_ps(p[2][0], p[0][0]);
+            const __m128 e1y = _mm_sub_ps(p[1][1], p[0][1]), e2y = _mm_sub_ps(p[2][1], p[0][1]);
+            const __m128 e1z = _mm_sub_ps(p[1][2], p[0][2]), e2z = _mm_sub_ps(p[2][2], p[0][2]);
+
+            float nx[4], ny[4], nz[4];
+            _mm_storeu_ps(nx, _mm_sub_ps(_mm_mul_ps(e1y, e2z), _mm_mul_ps(e1z, e2y)));
+            _mm_storeu_ps(ny, _mm_sub_ps(_mm_mul_ps(e1z, e2x), _mm_mul_ps(e1x, e2z)));
+            _mm_storeu_ps(nz, _mm_sub_ps(_mm_mul_ps(e1x, e2y), _mm_mul_ps(e1y, e2x)));
+
+            for (int i = 0; i < 4; ++i)
+                out[t + i - begin] = glm::vec3(nx[i], ny[i], nz[i]);
+        }
+#endif
+        for (; t < end; ++t)
+        {
+            const glm::vec3 &p0 = vertices[indices[t * 3]].Position;
+            const glm::vec3 &p1 = vertices[indices[t * 3 + 1]].Position;
+            const glm::vec3 &p2 = vertices[indices[t * 3 + 2]].Position;
+            out[t - begin] = glm::cross(p1 - p0, p2 - p0);
+        }
+    }
+
+    float cornerAngle(const glm::vec3 &corner, const glm::vec3 &a, const glm::vec3 &b)
+    {
+        const float la = glm::length(a - corner);
+        const float lb = glm::length(b - corner);
+        if (la == 0.f || lb == 0.f)
+            return 0.f;
+        const float cosine = glm::dot(a - corner, b - corner) / (la * lb);
+        return std::acos(std::max(-1.f, std::min(1.f, cosine)));
+    }
+
+    void facetedNormals(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices, ThreadPool &pool)
+    {
+        // every corner gets its own vertex so that no two faces share a normal
+        std::vector<Vertex> split(indices.size());
+        pool.parallelFor(indices.size(), VERTEX_GRAIN, [&](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                split[i] = vertices[indices[i]];
+                indices[i] = static_cast<unsigned int>(i);
+            }
+        });
+        vertices.swap(split);
+
+        pool.parallelFor(indices.size() / 3, TRIANGLE_GRAIN, [&](std::size_t begin, std::size_t end)
+        {
+            std::vector<glm::vec3> normals(end - begin);
+            faceNormals(vertices, indices, begin, end, normals.data());
+
+            for (std::size_t t = begin; t < end; ++t)
+            {
+                const float length = glm::length(normals[t - begin]);
+                if (length == 0.f)
+                    continue;
+                const glm::vec3 n = normals[t - begin] / length;
+                vertices[t * 3].Normal = vertices[t * 3 + 1].Normal = vertices[t * 3 + 2].Normal = n;
+            }
+        });
+    }
+
+    struct PositionHash
+    {
+        std::size_t operator()(const glm::vec3 &p) const
+        {
+            // adding zero turns -0 into +0, which compares equal
+            const float coordinates[3] = {p.x + 0.f, p.y + 0.f, p.z + 0.f};
+            std::uint32_t bits[3];
+            std::memcpy(bits, coordinates, sizeof(bits));
+            return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+        }
+    };
+
+    void smoothNormals(std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices, bool angleWeighted, ThreadPool &pool)
+    {
+        // vertices split only by texture coordinates share a position id
+        std::vector<unsigned int> positionId(vertices.size());
+        std::unordered_map<glm::vec3, unsigned int, PositionHash> positions(vertices.size());
+        for (std::size_t v = 0; v < vertices.size(); ++v)
+            positionId[v] = positions.emplace(vertices[v].Position, static_cast<unsigned int>(positions.size())).first->second;
+        const std::size_t positionCount = positions.size();
+
+        // weighted contribution of every triangle corner
+        std::vector<glm::vec3> cornerNormals(indices.size());
+        pool.parallelFor(indices.size() / 3, TRIANGLE_GRAIN, [&](std::size_t begin, std::size_t end)
+        {
+            std::vector<glm::vec3> normals(end - begin);
+            faceNormals(vertices, indices, begin, end, normals.data());
+
+            for (std::size_t t = begin; t < end; ++t)
+            {
+                const glm::vec3 &n = normals[t - begin];
+                if (!angleWeighted)
+                {
+                    cornerNormals[t * 3] = cornerNormals[t * 3 + 1] = cornerNormals[t * 3 + 2] = n;
+                    continue;
+                }
+
+                const float length = glm::length(n);
+                for (int k = 0; k < 3; ++k)
+                {
+                    const glm::vec3 &p = vertices[indices[t * 3 + k]].Position;
+                    const glm::vec3 &a = vertices[indices[t * 3 + (k + 1) % 3]].Position;
+                    const glm::vec3 &b = vertices[indices[t * 3 + (k + 2) % 3]].Position;
+                    cornerNormals[t * 3 + k] = length > 0.f ? n * (cornerAngle(p, a, b) / length) : glm::vec3(0.f);
+                }
+            }
+        });
+
+        // corners grouped by position, in index order so that the sums do not
+        // depend on scheduling
+        std::vector<unsigned int> cornerOffset(positionCount + 1, 0);
+        for (unsigned int index : indices)
+            cornerOffset[positionId[index] + 1]++;
+        for (std::size_t p = 0; p < positionCount; ++p)
+            cornerOffset[p + 1] += cornerOffset[p];
+
+        std::vector<unsigned int> corners(indices.size());
+        std::vector<unsigned int> fill(cornerOffset.begin(), cornerOffset.end() - 1);
+        for (std::size_t i = 0; i < indices.size(); ++i)
+            corners[fill[positionId[indices[i]]]++] = static_cast<unsigned int>(i);
+
+        std::vector<glm::vec3> positionNormals(positionCount);
+        pool.parallelFor(positionCount, VERTEX_GRAIN, [&](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t p = begin; p < end; ++p)
+            {
+                glm::vec3 sum(0.f);
+                for (unsigned int c = cornerOffset[p]; c < cornerOffset[p + 1]; ++c)
+                    sum += cornerNormals[corners[c]];
+                const float length = glm::length(sum);
+                positionNormals[p] = length > 0.f ? sum / length : glm::vec3(0.f);
+            }
+        });
+
+        pool.parallelFor(vertices.size(), VERTEX_GRAIN, [&](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t v = begin; v < end; ++v)
+            {
+                const glm::vec3 &n = positionNormals[positionId[v]];
+                if (n != glm::vec3(0.f))
+                    vertices[v].Normal = n;
+            }
+        });
+    }
+}
+
+void generateNormals(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices, NormalMode mode, ThreadPool &pool)
+{
+    switch (mode)
+    {
+    case NormalMode::Imported:
+        break;
+    case NormalMode::SmoothArea:
+        smoothNormals(vertices, indices, false, pool);
+        break;
+    case NormalMode::SmoothAngle:
+        smoothNormals(vertices, indices, true, pool);
+        break;
+    case NormalMode::Faceted:
+        facetedNormals(vertices, indices, pool);
+        break;
+    }
+}
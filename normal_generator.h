@@ -0,0 +1,22 @@
+#ifndef NORMAL_GENERATOR_H
+#define NORMAL_GENERATOR_H
+#include <vector>
+
+#include "mesh.h"
+
+class ThreadPool;
+
+enum class NormalMode
+{
+    Imported,    // keep the normals stored in the asset
+    SmoothArea,  // average of adjacent face normals weighted by face area
+    SmoothAngle, // average weighted by the corner angle at the vertex
+    Faceted      // one normal per face; shared vertices are split
+};
+
+// Smooth modes average across every vertex at the same position, so seams in
+// the texture coordinates do not show up as shading seams. Faceted may grow
+// the vertex array. Degenerate faces keep the imported normal.
+void generateNormals(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices, NormalMode mode, ThreadPool &pool);
+
+#endif
@@ -2,22 +2,38 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
+#ifdef BEZIER_TILES
+layout (location = 3) in vec4 aTile;      // per instance, see bezier_tile_uv
+layout (location = 4) in vec4 aTileEdges;
+#endif
+
+#include "uniform_blocks.glsl"
+
+#ifdef BEZIER_SURFACE
+#include "bezier_surface.glsl"
+#endif
 
 out vec2 TexCoords;
 out vec3 FragPosView;
 out vec3 Normal;      // view
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-uniform mat3 normViewModelMatrix;
-
 void main()
 {
-    vec4 worldPos = model * vec4(aPos, 1.0);
+#ifdef BEZIER_SURFACE
+    vec3 position, normal;
+#ifdef BEZIER_TILES
+    bezier_surface(bezier_tile_uv(aPos.xy, aTile, aTileEdges), position, normal);
+#else
+    bezier_surface(aPos.xy, position, normal);
+#endif
+#else
+    vec3 position = aPos;
+    vec3 normal = aNormal;
+#endif
+    vec4 worldPos = model * vec4(position, 1.0);
     vec4 viewPos = view * worldPos;
     FragPosView = vec3(viewPos);
     TexCoords = aTexCoords;
-    Normal = normViewModelMatrix * aNormal;
+    Normal = normViewModelMatrix * normal;
     gl_Position = projection * viewPos;
 }
@@ -0,0 +1,169 @@
+#include "program_cache.h"
+#include <GLFW/glfw3.h>
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+    const char MAGIC[8] = {'A', 'P', 'P', 'R', 'O', 'G', '\0', '\0'};
+    const std::uint32_t VERSION = 1;
+    const char *CACHE_DIRECTORY = "shadercache";
+
+    struct FileHeader
+    {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t format;
+        std::uint64_t key;
+        std::uint64_t length;
+    };
+
+    std::uint64_t hashBytes(std::uint64_t hash, const void *data, std::size_t size)
+    {
+        const unsigned char *bytes = static_cast<const unsigned char *>(data);
+        for (std::size_t i = 0; i < size; ++i)
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        return hash;
+    }
+
+    std::uint64_t hashString(std::uint64_t hash, const char *text)
+    {
+        // length first, so that ("ab", "c") and ("a", "bc") differ
+        const std::uint64_t length = text ? std::strlen(text) : 0;
+        hash = hashBytes(hash, &length, sizeof(length));
+        return hashBytes(hash, text, length);
+    }
+
+    bool hasExtension(const char *name)
+    {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; ++i)
+            if (std::strcmp(reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i)), name) == 0)
+                return true;
+        return false;
+    }
+
+    // GL_ARB_get_program_binary is not part of the generated loader; its entry
+    // points share the core names, so they fill the loader's empty pointers
+    bool loadProgramBinaryExtension()
+    {
+        if (!hasExtension("GL_ARB_get_program_binary"))
+            return false;
+
+        glad_glGetProgramBinary = reinterpret_cast<PFNGLGETPROGRAMBINARYPROC>(glfwGetProcAddress("glGetProgramBinary"));
+        glad_glProgramBinary = reinterpret_cast<PFNGLPROGRAMBINARYPROC>(glfwGetProcAddress("glProgramBinary"));
+        glad_glProgramParameteri = reinterpret_cast<PFNGLPROGRAMPARAMETERIPROC>(glfwGetProcAddress("glProgramParameteri"));
+        return glad_glGetProgramBinary && glad_glProgramBinary && glad_glProgramParameteri;
+    }
+
+    std::string binaryPath(std::uint64_t key)
+    {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+        return std::string(CACHE_DIRECTORY) + '/' + name;
+    }
+}
+
+bool programBinarySupported()
+{
+    static const bool supported = []()
+    {
+        if (!GLAD_GL_VERSION_4_1 && !loadProgramBinaryExtension())
+            return false;
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        return formats > 0;
+    }();
+    return supported;
+}
+
+std::uint64_t programCacheKey(const std::vector<std::string> &sources)
+{
+    std::uint64_t hash = 14695981039346656037ull;
+    hash = hashBytes(hash, &VERSION, sizeof(VERSION));
+
+    for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION})
+        hash = hashString(hash, reinterpret_cast<const char *>(glGetString(name)));
+
+    for (const std::string &source : sources)
+        hash = hashString(hash, source.c_str());
+    return hash;
+}
+
+bool loadProgramBinary(GLuint program, std::uint64_t key)
+{
+    if (!programBinarySupported())
+        return false;
+
+    std::ifstream file(binaryPath(key), std::ios::binary);
+    if (!file)
+        return false;
+
+    FileHeader header;
+    if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        header.version != VERSION ||
+        header.key != key ||
+        header.length == 0 || header.length > (1u << 30))
+        return false;
+
+    std::vector<char> binary(header.length);
+    if (!file.read(binary.data(), binary.size()))
+        return false;
+
+    glProgramBinary(program, header.format, binary.data(), static_cast<GLsizei>(binary.size()));
+
+    // drivers reject binaries from other versions or hardware
+    GLint success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    return success != 0;
+}
+
+void storeProgramBinary(GLuint program, std::uint64_t key)
+{
+    if (!programBinarySupported())
+        return;
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, nullptr, &format, binary.data());
+
+    std::error_code ec;
+    std::filesystem::create_directories(CACHE_DIRECTORY, ec);
+
+    const std::string path = binaryPath(key);
+    const std::string tmpPath = path + ".tmp";
+    std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        std::cerr << "\n[Program cache not writable] " << tmpPath << '\n';
+        return;
+    }
+
+    FileHeader header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.format = format;
+    header.key = key;
+    header.length = binary.size();
+
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(binary.data(), binary.size());
+    file.close();
+
+    if (!file || std::rename(tmpPath.c_str(), path.c_str()) != 0)
+    {
+        std::cerr << "\n[Program cache write failed] " << path << '\n';
+        std::remove(tmpPath.c_str());
+    }
+}
@@ -0,0 +1,25 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+
+// Linked program binaries, one file per program in "shadercache/". The key
+// hashes the final GLSL text of every stage (defines included) together with
+// the driver's vendor, renderer and version strings, so editing a shader or
+// updating the driver simply misses the cache.
+
+// GL 4.1 or GL_ARB_get_program_binary, and at least one binary format
+bool programBinarySupported();
+
+std::uint64_t programCacheKey(const std::vector<std::string> &sources);
+
+// false when there is no binary for the key or the driver rejects it; the
+// program then has to be compiled from source
+bool loadProgramBinary(GLuint program, std::uint64_t key);
+
+// the program must have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+void storeProgramBinary(GLuint program, std::uint64_t key);
+
+#endif
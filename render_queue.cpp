@@ -0,0 +1,186 @@
+#include "render_queue.h"
+#include "gl_state.h"
+#include "model.h"
+#include "render_stats.h"
+#include "shader.h"
+#include "static_batch.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+
+namespace
+{
+    const int LAYER_SHIFT = 62;
+    const int STATE_SHIFT = 60;
+    const int PROGRAM_SHIFT = 48;
+    const int MATERIAL_SHIFT = 32;
+    const int DEPTH_SHIFT = 8;
+
+    const std::uint64_t PROGRAM_MASK = 0xFFF;
+    const std::uint64_t MATERIAL_MASK = 0xFFFF;
+    const std::uint64_t DEPTH_MAX = 0xFFFFFF;
+
+    // drawables per build job and objects per constants chunk
+    const std::size_t JOB_GRAIN = 64;
+    const std::size_t OBJECT_GRAIN = 16;
+}
+
+void RenderQueue::begin(const glm::mat4 &view, const glm::mat4 &projection, float farPlane)
+{
+    this->view = view;
+    this->projection = projection;
+    this->farPlane = farPlane;
+    objects.clear();
+    frustums.clear();
+    instances.clear();
+    jobs.clear();
+    packets.clear();
+    entries.clear();
+}
+
+int RenderQueue::addObject(const ObjectBlock &object)
+{
+    objects.push_back(object);
+    return static_cast<int>(objects.size()) - 1;
+}
+
+void RenderQueue::push(const DrawPacket &packet)
+{
+    packets.push_back(packet);
+}
+
+void RenderQueue::addInstance(const Model &model, const Shader &shader, const ObjectBlock &object)
+{
+    const std::size_t instance = instances.size();
+    instances.push_back({&model, &shader, addObject(object)});
+
+    const std::size_t count = model.drawableCount();
+    for (std::size_t begin = 0; begin < count; begin += JOB_GRAIN)
+        jobs.push_back({instance, begin, std::min(begin + JOB_GRAIN, count)});
+}
+
+std::uint64_t RenderQueue::sortKey(const DrawPacket &packet) const
+{
+    const glm::mat4 model = packet.object >= 0 ? objects[packet.object].model : glm::mat4(1.f);
+    const float depth = -(view * model * glm::vec4(packet.center, 1.f)).z;
+    const float normalized = std::max(0.f, std::min(1.f, depth / farPlane));
+
+    const std::uint64_t state = (packet.cullFace ? 0u : 1u) | (packet.depthFunc == GL_LESS ? 0u : 2u);
+    const std::uint64_t program = packet.shader->ID & PROGRAM_MASK;
+    const std::uint64_t material = packet.material ? packet.material->sortKey() : 0u;
+
+    return static_cast<std::uint64_t>(packet.layer) << LAYER_SHIFT |
+           state << STATE_SHIFT |
+           program << PROGRAM_SHIFT |
+           (material & MATERIAL_MASK) << MATERIAL_SHIFT |
+           static_cast<std::uint64_t>(normalized * DEPTH_MAX) << DEPTH_SHIFT;
+}
+
+void RenderQueue::build(ThreadPool &pool)
+{
+    // per-object constants: the normal matrix and the object-space frustum
+    frustums.resize(objects.size());
+    const glm::mat4 viewProjection = projection * view;
+    pool.parallelFor(objects.size(), OBJECT_GRAIN, [this, &viewProjection](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            const glm::mat4 viewModel = view * objects[i].model;
+            objects[i].setNormalMatrix(glm::mat3(glm::transpose(glm::inverse(viewModel))));
+            frustums[i] = Frustum::fromMatrix(viewProjection * objects[i].model);
+        }
+    });
+
+    if (lists.size() < jobs.size())
+        lists.resize(jobs.size());
+
+    pool.parallelFor(jobs.size(), 1, [this](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t j = begin; j < end; ++j)
+        {
+            const Job &job = jobs[j];
+            const Instance &instance = instances[job.instance];
+            CommandList &list = lists[j];
+            list.packets.clear();
+            list.keys.clear();
+
+            DrawPacket prototype;
+            prototype.shader = instance.shader;
+            prototype.object = instance.object;
+            instance.model->collectPackets(job.begin, job.end, prototype, frustums[instance.object], list.packets);
+
+            list.culled = static_cast<unsigned int>(job.end - job.begin - list.packets.size());
+            for (const DrawPacket &packet : list.packets)
+                list.keys.push_back(sortKey(packet));
+        }
+    });
+
+    // pushed packets first, then every job's packets
+    for (std::size_t i = 0; i < packets.size(); ++i)
+        entries.push_back({sortKey(packets[i]), static_cast<std::uint32_t>(i)});
+
+    for (std::size_t j = 0; j < jobs.size(); ++j)
+    {
+        const CommandList &list = lists[j];
+        for (std::size_t i = 0; i < list.packets.size(); ++i)
+        {
+            entries.push_back({list.keys[i], static_cast<std::uint32_t>(packets.size())});
+            packets.push_back(list.packets[i]);
+        }
+        renderStats.culled += list.culled;
+    }
+
+    // packet order breaks ties, so equal keys draw in submission order
+    std::sort(entries.begin(), entries.end(), [](const SortEntry &a, const SortEntry &b)
+    {
+        return a.key != b.key ? a.key < b.key : a.packet < b.packet;
+    });
+}
+
+void RenderQueue::submit(UniformBuffer<ObjectBlock> &objectUniforms)
+{
+    int boundObject = -1;
+    for (const SortEntry &entry : entries)
+    {
+        const DrawPacket &packet = packets[entry.packet];
+
+        glState.setCullFace(packet.cullFace);
+        glState.depthFunc(packet.depthFunc);
+        packet.shader->use();
+
+        if (packet.object >= 0 && packet.object != boundObject)
+        {
+            objectUniforms.update(objects[packet.object]);
+            boundObject = packet.object;
+        }
+
+        if (packet.material)
+            packet.material->bind();
+        if (packet.cubeMap)
+            glState.bindTexture(0, GL_TEXTURE_CUBE_MAP, packet.cubeMap);
+
+        switch (packet.kind)
+        {
+        case DrawPacket::Kind::Elements:
+            glState.bindVertexArray(packet.VAO);
+            if (packet.instanceCount != 1)
+                glDrawElementsInstancedBaseVertex(GL_TRIANGLES, packet.count, packet.indexType, 0,
+                                                  packet.instanceCount, packet.baseVertex);
+            else if (packet.baseVertex)
+                glDrawElementsBaseVertex(GL_TRIANGLES, packet.count, packet.indexType, 0, packet.baseVertex);
+            else
+                glDrawElements(GL_TRIANGLES, packet.count, packet.indexType, 0);
+            renderStats.drawCalls++;
+            renderStats.meshDraws++;
+            break;
+        case DrawPacket::Kind::Arrays:
+            glState.bindVertexArray(packet.VAO);
+            glDrawArrays(GL_TRIANGLES, packet.first, packet.count);
+            renderStats.drawCalls++;
+            break;
+        case DrawPacket::Kind::BatchGroup:
+            packet.batch->drawGroup(packet.group);
+            break;
+        }
+    }
+}
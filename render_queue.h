@@ -0,0 +1,130 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "frustum.h"
+#include "material.h"
+#include "uniform_blocks.h"
+
+class Model;
+class Shader;
+class StaticBatch;
+class ThreadPool;
+
+enum class RenderLayer
+{
+    Opaque,
+    Sky // after all opaque geometry, where the depth buffer hides most of it
+};
+
+// Everything needed to issue one draw call.
+struct DrawPacket
+{
+    enum class Kind
+    {
+        Elements,   // glDrawElements(count, indexType), offset by baseVertex or instanced
+        Arrays,     // glDrawArrays(first, count)
+        BatchGroup  // one multi-draw of a StaticBatch group
+    };
+
+    Kind kind = Kind::Elements;
+    RenderLayer layer = RenderLayer::Opaque;
+
+    const Shader *shader = nullptr;
+    const Material *material = nullptr; // nullptr leaves the bound textures
+    GLuint cubeMap = 0;                 // bound on unit 0 when non-zero
+    GLuint VAO = 0;
+    int object = -1;                    // RenderQueue::addObject index, -1 for none
+
+    bool cullFace = true;
+    GLenum depthFunc = GL_LESS;
+
+    glm::vec3 center = glm::vec3(0.f); // object space, for depth sorting
+
+    GLsizei count = 0;
+    GLenum indexType = GL_UNSIGNED_INT;
+    GLint baseVertex = 0; // e.g. the StreamBuffer region holding the vertices
+    GLsizei instanceCount = 1;
+    GLint first = 0;
+    const StaticBatch *batch = nullptr;
+    std::size_t group = 0;
+};
+
+// Draw packets of a frame, sorted by a 64-bit key before submission:
+//   63..62 layer | 61..60 cull/depth state | 59..48 program | 47..32 material | 31..8 view depth
+// so draws are grouped by the expensive state changes and, within equal
+// state, go front to back for early depth rejection.
+//
+// Building the frame makes no GL calls: build() computes the per-object
+// constants, culls and turns model instances into keyed packets on the
+// thread pool, and only submit() talks to GL, replaying the sorted packets.
+class RenderQueue
+{
+public:
+    void begin(const glm::mat4 &view, const glm::mat4 &projection, float farPlane);
+
+    // per-object uniform data, uploaded when the first packet that uses it
+    // is submitted; build() fills in the normal matrix
+    int addObject(const ObjectBlock &object);
+
+    // a packet drawn as is, without culling
+    void push(const DrawPacket &packet);
+
+    // every mesh (or batch group) of the model, culled against the view
+    void addInstance(const Model &model, const Shader &shader, const ObjectBlock &object);
+
+    void build(ThreadPool &pool);
+
+    void submit(UniformBuffer<ObjectBlock> &objectUniforms);
+
+    std::size_t size() const { return entries.size(); }
+
+private:
+    struct SortEntry
+    {
+        std::uint64_t key;
+        std::uint32_t packet;
+    };
+
+    struct Instance
+    {
+        const Model *model;
+        const Shader *shader;
+        int object;
+    };
+
+    // a range of one instance's drawables, built by one job
+    struct Job
+    {
+        std::size_t instance;
+        std::size_t begin, end;
+    };
+
+    // packets of one job, merged in job order so the frame is deterministic
+    struct CommandList
+    {
+        std::vector<DrawPacket> packets;
+        std::vector<std::uint64_t> keys;
+        unsigned int culled = 0;
+    };
+
+    glm::mat4 view = glm::mat4(1.f);
+    glm::mat4 projection = glm::mat4(1.f);
+    float farPlane = 1.f;
+
+    std::vector<ObjectBlock> objects;
+    std::vector<Frustum> frustums; // per object, in its model space
+    std::vector<Instance> instances;
+    std::vector<Job> jobs;
+    std::vector<CommandList> lists; // reused across frames
+    std::vector<DrawPacket> packets;
+    std::vector<SortEntry> entries;
+
+    std::uint64_t sortKey(const DrawPacket &packet) const;
+};
+
+#endif
@@ -0,0 +1,16 @@
+#include "render_stats.h"
+
+RenderStats renderStats;
+
+std::ostream &operator<<(std::ostream &os, const RenderStats &stats)
+{
+    return os << "[Frame] draw calls " << stats.drawCalls
+              << ", meshes " << stats.meshDraws
+              << ", culled " << stats.culled
+              << ", uniforms issued " << stats.uniformsIssued
+              << ", skipped " << stats.uniformsSkipped
+              << ", block bytes uploaded " << stats.blockBytesUploaded
+              << ", skipped " << stats.blockBytesSkipped
+              << ", state changes " << stats.stateChanges
+              << ", skipped " << stats.stateChangesSkipped;
+}
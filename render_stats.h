@@ -0,0 +1,28 @@
+#ifndef RENDER_STATS_H
+#define RENDER_STATS_H
+#include <cstddef>
+#include <ostream>
+
+// Per-frame counters, reset by the main loop at the start of every frame.
+struct RenderStats
+{
+    unsigned int drawCalls = 0; // glDraw* calls issued
+    unsigned int meshDraws = 0; // meshes covered by those calls
+    unsigned int culled = 0;    // meshes or batch groups outside the view
+
+    unsigned int uniformsIssued = 0;  // glUniform* calls that changed a value
+    unsigned int uniformsSkipped = 0; // setter calls dropped as redundant
+    std::size_t blockBytesUploaded = 0; // uniform buffer bytes sent
+    std::size_t blockBytesSkipped = 0;  // unchanged uniform buffer bytes not sent
+
+    unsigned int stateChanges = 0;        // binds/enables that reached GL (GlState)
+    unsigned int stateChangesSkipped = 0; // redundant ones dropped
+
+    void reset() { *this = RenderStats(); }
+};
+
+extern RenderStats renderStats;
+
+std::ostream &operator<<(std::ostream &os, const RenderStats &stats);
+
+#endif
@@ -1,155 +1,443 @@
 // http://learnopengl.com/
 #include "shader.h"
+#include "gl_state.h"
+#include "program_cache.h"
+#include "render_stats.h"
+#include <GLFW/glfw3.h>
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 
-Shader::Shader(const char *vertexPath,
-               const char *fragmentPath,
-               const char *geometryPath)
-{
-    std::string vertexCode;
-    std::string fragmentCode;
-    std::string geometryCode;
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
 
-    std::ifstream vShaderFile;
-    std::ifstream fShaderFile;
-    std::ifstream gShaderFile;
+namespace
+{
+    // GL_KHR_parallel_shader_compile is not part of the generated loader
+    typedef void (APIENTRYP MaxShaderCompilerThreadsProc)(GLuint count);
 
-    vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    gShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+    bool hasExtension(const char *name)
+    {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; ++i)
+            if (std::strcmp(reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i)), name) == 0)
+                return true;
+        return false;
+    }
 
-    try
+    // lets the driver compile on its own threads; true when completion can
+    // be polled with GL_COMPLETION_STATUS_KHR
+    bool parallelCompile()
     {
-        vShaderFile.open(vertexPath);
-        fShaderFile.open(fragmentPath);
-        std::stringstream vShaderStream, fShaderStream;
+        static const bool supported = []()
+        {
+            const char *function = hasExtension("GL_KHR_parallel_shader_compile") ? "glMaxShaderCompilerThreadsKHR" :
+                                   hasExtension("GL_ARB_parallel_shader_compile") ? "glMaxShaderCompilerThreadsARB" : nullptr;
+            if (!function)
+                return false;
+
+            auto maxThreads = reinterpret_cast<MaxShaderCompilerThreadsProc>(glfwGetProcAddress(function));
+            if (maxThreads)
+                maxThreads(0xFFFFFFFFu); // as many as the driver likes
+            return true;
+        }();
+        return supported;
+    }
+
+    const int MAX_INCLUDE_DEPTH = 16;
 
-        vShaderStream << vShaderFile.rdbuf();
-        fShaderStream << fShaderFile.rdbuf();
+    bool readFile(const std::string &path, std::string &text)
+    {
+        std::ifstream file(path);
+        if (!file)
+            return false;
+        std::stringstream stream;
+        stream << file.rdbuf();
+        text = stream.str();
+        return true;
+    }
 
-        vShaderFile.close();
-        fShaderFile.close();
+    // Expands `#include "file"` (relative to the including file) in place.
+    // Every file is included once; #line directives keep compiler messages
+    // pointing at the original lines, with the file's include order as the
+    // source string number.
+    bool expandIncludes(const std::string &path, std::string &out, std::vector<std::string> &included, int depth)
+    {
+        std::string text;
+        if (depth > MAX_INCLUDE_DEPTH || !readFile(path, text))
+        {
+            std::cerr << "\n[Shader include not found] " << path << '\n';
+            return false;
+        }
 
-        vertexCode = vShaderStream.str();
-        fragmentCode = fShaderStream.str();
+        const std::size_t slash = path.find_last_of('/');
+        const std::string directory = slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+        const int sourceNumber = static_cast<int>(included.size()) - 1;
 
-        if (geometryPath)
+        std::istringstream lines(text);
+        std::string line;
+        for (int lineNumber = 1; std::getline(lines, line); ++lineNumber)
         {
-            gShaderFile.open(geometryPath);
-            std::stringstream gShaderStream;
-            gShaderStream << gShaderFile.rdbuf();
-            gShaderFile.close();
-            geometryCode = gShaderStream.str();
+            const std::size_t directive = line.find_first_not_of(" \t");
+            if (directive == std::string::npos || line.compare(directive, 8, "#include") != 0)
+            {
+                out += line;
+                out += '\n';
+                continue;
+            }
+
+            const std::size_t open = line.find('"', directive);
+            const std::size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+            if (close == std::string::npos)
+            {
+                std::cerr << "\n[Malformed shader include] " << path << ':' << lineNumber << '\n';
+                return false;
+            }
+
+            const std::string includePath = directory + line.substr(open + 1, close - open - 1);
+            if (std::find(included.begin(), included.end(), includePath) == included.end())
+            {
+                included.push_back(includePath);
+                out += "#line 1 " + std::to_string(included.size() - 1) + '\n';
+                if (!expandIncludes(includePath, out, included, depth + 1))
+                    return false;
+            }
+            out += "#line " + std::to_string(lineNumber + 1) + ' ' + std::to_string(sourceNumber) + '\n';
         }
+        return true;
     }
-    catch (std::ifstream::failure &e)
+
+    // the source with includes expanded and the defines placed right after
+    // the #version line
+    bool loadSource(const std::string &path, const std::vector<std::string> &defines, std::string &source)
     {
-        std::cerr << "\n[File unsuccessfully read]\n";
+        std::vector<std::string> included = {path};
+        std::string body;
+        if (!expandIncludes(path, body, included, 0))
+            return false;
+
+        std::size_t versionEnd = 0;
+        if (body.compare(0, 8, "#version") == 0)
+            versionEnd = body.find('\n') + 1;
+
+        source.assign(body, 0, versionEnd);
+        for (const std::string &define : defines)
+            source += "#define " + define + '\n';
+        if (!defines.empty())
+            source += versionEnd ? "#line 2 0\n" : "#line 1 0\n";
+        source.append(body, versionEnd, std::string::npos);
+        return true;
     }
 
-    const char *vShaderCode = vertexCode.c_str();
-    const char *fShaderCode = fragmentCode.c_str();
+    std::size_t hashName(const char *name)
+    {
+        std::size_t hash = 2166136261u;
+        for (; *name; ++name)
+            hash = (hash ^ static_cast<unsigned char>(*name)) * 16777619u;
+        return hash;
+    }
+}
 
-    unsigned int vertex, fragment;
+Shader::Shader(const char *vertexPath,
+               const char *fragmentPath,
+               const char *geometryPath,
+               const std::vector<std::string> &defines)
+{
+    std::string vertexCode;
+    std::string fragmentCode;
+    std::string geometryCode;
 
-    vertex = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex, 1, &vShaderCode, NULL);
-    glCompileShader(vertex);
-    checkCompileErrors(vertex, "VERTEX");
+    if (!loadSource(vertexPath, defines, vertexCode) ||
+        !loadSource(fragmentPath, defines, fragmentCode) ||
+        (geometryPath && !loadSource(geometryPath, defines, geometryCode)))
+    {
+        std::cerr << "\n[File unsuccessfully read]\n";
+    }
 
-    fragment = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment, 1, &fShaderCode, NULL);
-    glCompileShader(fragment);
-    checkCompileErrors(fragment, "FRAGMENT");
+    parallelCompile();
 
-    unsigned int geometry;
-    if (geometryPath)
+    // a cached binary skips compiling and linking altogether
+    cacheKey = programCacheKey({vertexCode, fragmentCode, geometryCode});
+    ID = glCreateProgram();
+    if (loadProgramBinary(ID, cacheKey))
     {
-        const char *gShaderCode = geometryCode.c_str();
-        geometry = glCreateShader(GL_GEOMETRY_SHADER);
-        glShaderSource(geometry, 1, &gShaderCode, NULL);
-        glCompileShader(geometry);
-        checkCompileErrors(geometry, "GEOMETRY");
+        buildUniformTable();
+        return;
     }
 
+    // a rejected binary leaves the program unusable
+    glDeleteProgram(ID);
     ID = glCreateProgram();
-    glAttachShader(ID, vertex);
-    glAttachShader(ID, fragment);
-    if (geometryPath)
-        glAttachShader(ID, geometry);
+
+    const GLenum stageTypes[3] = {GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, GL_GEOMETRY_SHADER};
+    const std::string *stageCode[3] = {&vertexCode, &fragmentCode, geometryPath ? &geometryCode : nullptr};
+    for (int i = 0; i < 3; ++i)
+    {
+        if (!stageCode[i])
+            continue;
+
+        const char *code = stageCode[i]->c_str();
+        stages[i] = glCreateShader(stageTypes[i]);
+        glShaderSource(stages[i], 1, &code, NULL);
+        glCompileShader(stages[i]);
+        glAttachShader(ID, stages[i]);
+    }
+
+    if (programBinarySupported())
+        glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 
     glLinkProgram(ID);
+    buildPending = true;
+}
+
+void Shader::finishBuild() const
+{
+    if (!buildPending)
+        return;
+    buildPending = false;
+
+    // the first status query waits for the driver
+    const char *stageNames[3] = {"VERTEX", "FRAGMENT", "GEOMETRY"};
+    for (int i = 0; i < 3; ++i)
+        if (stages[i])
+            checkCompileErrors(stages[i], stageNames[i]);
     checkCompileErrors(ID, "PROGRAM");
 
-    glDeleteShader(vertex);
-    glDeleteShader(fragment);
-    if (geometryPath)
-        glDeleteShader(geometry);
+    buildUniformTable();
+
+    for (const auto &block : pendingBlocks)
+        bindUniformBlock(block.first.c_str(), block.second);
+    pendingBlocks.clear();
+    applySamplers();
+
+    GLint linked = 0;
+    glGetProgramiv(ID, GL_LINK_STATUS, &linked);
+    if (linked)
+        storeProgramBinary(ID, cacheKey);
+
+    for (GLuint &stage : stages)
+    {
+        if (stage)
+            glDeleteShader(stage);
+        stage = 0;
+    }
+}
+
+void Shader::bindSampler(const char *name, int unit) const
+{
+    pendingSamplers.emplace_back(name, unit);
+    if (!buildPending)
+        applySamplers();
+}
+
+void Shader::applySamplers() const
+{
+    if (pendingSamplers.empty())
+        return;
+
+    // plain glUniform calls need the program bound; every draw binds its
+    // own program through GlState, so it is not restored
+    glState.useProgram(ID);
+
+    for (const auto &sampler : pendingSamplers)
+        setInt(sampler.first.c_str(), sampler.second);
+    pendingSamplers.clear();
+}
+
+bool Shader::ready() const
+{
+    if (!buildPending || !parallelCompile())
+        return true;
+
+    GLint done = GL_FALSE;
+    glGetProgramiv(ID, GL_COMPLETION_STATUS_KHR, &done);
+    return done == GL_TRUE;
 }
 
 void Shader::use() const
 {
-    glUseProgram(ID);
+    finishBuild();
+    glState.useProgram(ID);
 }
 
 void Shader::setBool(const char *name, bool value) const
 {
-    glUniform1i(glGetUniformLocation(ID, name), (int)value);
+    set(handleFor<bool>(name), value);
 }
 
 void Shader::setInt(const char *name, int value) const
 {
-    glUniform1i(glGetUniformLocation(ID, name), value);
+    set(handleFor<int>(name), value);
 }
 
 void Shader::setFloat(const char *name, float value) const
 {
-    glUniform1f(glGetUniformLocation(ID, name), value);
+    set(handleFor<float>(name), value);
 }
 
 void Shader::setVec2(const char *name, const glm::vec2 &value) const
 {
-    glUniform2fv(glGetUniformLocation(ID, name), 1, &value[0]);
+    set(handleFor<glm::vec2>(name), value);
 }
 void Shader::setVec2(const char *name, float x, float y) const
 {
-    glUniform2f(glGetUniformLocation(ID, name), x, y);
+    set(handleFor<glm::vec2>(name), glm::vec2(x, y));
 }
 
 void Shader::setVec3(const char *name, const glm::vec3 &value) const
 {
-    glUniform3fv(glGetUniformLocation(ID, name), 1, &value[0]);
+    set(handleFor<glm::vec3>(name), value);
 }
 void Shader::setVec3(const char *name, float x, float y, float z) const
 {
-    glUniform3f(glGetUniformLocation(ID, name), x, y, z);
+    set(handleFor<glm::vec3>(name), glm::vec3(x, y, z));
 }
 
 void Shader::setVec4(const char *name, const glm::vec4 &value) const
 {
-    glUniform4fv(glGetUniformLocation(ID, name), 1, &value[0]);
+    set(handleFor<glm::vec4>(name), value);
 }
 void Shader::setVec4(const char *name, float x, float y, float z, float w) const
 {
-    glUniform4f(glGetUniformLocation(ID, name), x, y, z, w);
+    set(handleFor<glm::vec4>(name), glm::vec4(x, y, z, w));
 }
 
 void Shader::setMat2(const char *name, const glm::mat2 &mat) const
 {
-    glUniformMatrix2fv(glGetUniformLocation(ID, name), 1, GL_FALSE, &mat[0][0]);
+    set(handleFor<glm::mat2>(name), mat);
 }
 
 void Shader::setMat3(const char *name, const glm::mat3 &mat) const
 {
-    glUniformMatrix3fv(glGetUniformLocation(ID, name), 1, GL_FALSE, &mat[0][0]);
+    set(handleFor<glm::mat3>(name), mat);
 }
 
 void Shader::setMat4(const char *name, const glm::mat4 &mat) const
 {
-    glUniformMatrix4fv(glGetUniformLocation(ID, name), 1, GL_FALSE, &mat[0][0]);
+    set(handleFor<glm::mat4>(name), mat);
+}
+
+void Shader::buildUniformTable() const
+{
+    GLint count = 0, maxLength = 0;
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+    std::vector<GLchar> buffer(maxLength > 0 ? maxLength : 1);
+    for (GLint i = 0; i < count; ++i)
+    {
+        GLint size;
+        GLenum type;
+        GLsizei length;
+        glGetActiveUniform(ID, static_cast<GLuint>(i), static_cast<GLsizei>(buffer.size()), &length, &size, &type, buffer.data());
+
+        std::string name(buffer.data(), length);
+        GLint location = glGetUniformLocation(ID, name.c_str());
+        if (location < 0)
+            continue; // uniform block member
+
+        // arrays of basic types are reported once as "name[0]"; the bare
+        // name shares that entry so one location has one shadow
+        const int slot = static_cast<int>(uniforms.size());
+        uniforms.push_back({location, type, {}, false});
+        uniformNames.emplace_back(name, slot);
+
+        const std::size_t bracket = name.size() > 3 ? name.rfind("[0]") : std::string::npos;
+        if (bracket != std::string::npos && bracket + 3 == name.size())
+        {
+            const std::string base = name.substr(0, bracket);
+            uniformNames.emplace_back(base, slot);
+            for (GLint element = 1; element < size; ++element)
+            {
+                const std::string elementName = base + '[' + std::to_string(element) + ']';
+                uniformNames.emplace_back(elementName, static_cast<int>(uniforms.size()));
+                uniforms.push_back({glGetUniformLocation(ID, elementName.c_str()), type, {}, false});
+            }
+        }
+    }
+
+    std::size_t bucketCount = 16;
+    while (bucketCount < uniformNames.size() * 2)
+        bucketCount *= 2;
+    uniformBuckets.assign(bucketCount, -1);
+
+    for (std::size_t i = 0; i < uniformNames.size(); ++i)
+    {
+        std::size_t bucket = hashName(uniformNames[i].first.c_str()) & (bucketCount - 1);
+        while (uniformBuckets[bucket] >= 0)
+            bucket = (bucket + 1) & (bucketCount - 1);
+        uniformBuckets[bucket] = static_cast<int>(i);
+    }
+}
+
+const Shader::UniformEntry *Shader::findUniform(const char *name) const
+{
+    finishBuild();
+    if (uniformBuckets.empty())
+        return nullptr;
+
+    const std::size_t mask = uniformBuckets.size() - 1;
+    for (std::size_t bucket = hashName(name) & mask; uniformBuckets[bucket] >= 0; bucket = (bucket + 1) & mask)
+    {
+        const std::pair<std::string, int> &entry = uniformNames[uniformBuckets[bucket]];
+        if (std::strcmp(entry.first.c_str(), name) == 0)
+            return &uniforms[entry.second];
+    }
+    return nullptr;
+}
+
+void Shader::bindUniformBlock(const char *name, GLuint binding) const
+{
+    if (buildPending)
+    {
+        pendingBlocks.emplace_back(name, binding);
+        return;
+    }
+
+    const GLuint index = glGetUniformBlockIndex(ID, name);
+    if (index != GL_INVALID_INDEX)
+        glUniformBlockBinding(ID, index, binding);
+}
+
+GLint Shader::uniformLocation(const char *name) const
+{
+    const UniformEntry *entry = findUniform(name);
+    return entry ? entry->location : -1;
+}
+
+bool Shader::changed(int slot, const void *value, std::size_t size) const
+{
+    if (slot < 0)
+        return false;
+
+    const UniformEntry &entry = uniforms[slot];
+    if (entry.shadowed && std::memcmp(entry.shadow, value, size) == 0)
+    {
+        renderStats.uniformsSkipped++;
+        return false;
+    }
+
+    std::memcpy(entry.shadow, value, size);
+    entry.shadowed = true;
+    renderStats.uniformsIssued++;
+    return true;
+}
+
+void Shader::checkUniformType(const char *name, GLint location, GLenum expected) const
+{
+    const UniformEntry *entry = location >= 0 ? findUniform(name) : nullptr;
+    if (!entry || entry->type == expected)
+        return;
+
+    // samplers are set as int
+    const bool sampler = entry->type == GL_SAMPLER_2D || entry->type == GL_SAMPLER_CUBE;
+    if (!(sampler && expected == GL_INT))
+        std::cerr << "\n[Uniform type mismatch] " << name << '\n';
 }
 
 void Shader::checkCompileErrors(GLuint shader, const std::string &type)
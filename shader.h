@@ -1,6 +1,7 @@
 // http://learnopengl.com/
 #ifndef SHADER_H
 #define SHADER_H
+#include <cstdint>
 #include <vector>
 #include <string>
 #include <glad/glad.h>
@@ -8,16 +9,37 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+// Pre-resolved uniform location; set through Shader::set without any
+// name lookup. T is the C++ type of the value (int also covers samplers).
+template <typename T>
+struct Uniform
+{
+    GLint location = -1;
+    int slot = -1; // entry in the program's uniform table
+
+    bool valid() const { return location >= 0; }
+};
+
 class Shader
 {
 public:
     unsigned int ID;
 
+    // Compiling and linking are only submitted here; errors are checked and
+    // the driver is waited for when the program is first bound or queried,
+    // so several programs build in parallel with other startup work.
+    // Sources may `#include "file"`; every entry of `defines` ("NAME" or
+    // "NAME value") is injected after the #version line of each stage.
     Shader(const char *vertexPath,
            const char *fragmentPath,
-           const char *geometryPath = nullptr);
+           const char *geometryPath = nullptr,
+           const std::vector<std::string> &defines = {});
 
     void use() const;
+
+    // true once binding the program will not wait for the driver (always
+    // true without GL_KHR_parallel_shader_compile)
+    bool ready() const;
     void setInt(const char *name, int value) const;
     void setFloat(const char *name, float value) const;
 
@@ -32,8 +54,131 @@ public:
     void setMat3(const char *name, const glm::mat3 &mat) const;
     void setMat4(const char *name, const glm::mat4 &mat) const;
 
+    // attaches the named uniform block, if the program uses it, to a binding
+    // point; deferred until the link has finished
+    void bindUniformBlock(const char *name, GLuint binding) const;
+
+    // points a sampler uniform at a texture unit for good; deferred like
+    // bindUniformBlock
+    void bindSampler(const char *name, int unit) const;
+
+    // -1 for names that are not active uniforms of the program
+    GLint uniformLocation(const char *name) const;
+
+    template <typename T>
+    Uniform<T> uniform(const char *name) const
+    {
+        Uniform<T> handle = handleFor<T>(name);
+        checkUniformType(name, handle.location, glTypeOf(static_cast<const T *>(nullptr)));
+        return handle;
+    }
+
+    // Every setter compares the value with what this program last received
+    // and skips the GL call when nothing changed (see RenderStats).
+    void set(Uniform<int> uniform, int value) const
+    {
+        if (changed(uniform.slot, &value, sizeof(value)))
+            glUniform1i(uniform.location, value);
+    }
+    void set(Uniform<bool> uniform, bool value) const
+    {
+        const int asInt = (int)value;
+        if (changed(uniform.slot, &asInt, sizeof(asInt)))
+            glUniform1i(uniform.location, asInt);
+    }
+    void set(Uniform<float> uniform, float value) const
+    {
+        if (changed(uniform.slot, &value, sizeof(value)))
+            glUniform1f(uniform.location, value);
+    }
+    void set(Uniform<glm::vec2> uniform, const glm::vec2 &value) const
+    {
+        if (changed(uniform.slot, &value[0], sizeof(value)))
+            glUniform2fv(uniform.location, 1, &value[0]);
+    }
+    void set(Uniform<glm::vec3> uniform, const glm::vec3 &value) const
+    {
+        if (changed(uniform.slot, &value[0], sizeof(value)))
+            glUniform3fv(uniform.location, 1, &value[0]);
+    }
+    void set(Uniform<glm::vec4> uniform, const glm::vec4 &value) const
+    {
+        if (changed(uniform.slot, &value[0], sizeof(value)))
+            glUniform4fv(uniform.location, 1, &value[0]);
+    }
+    void set(Uniform<glm::mat2> uniform, const glm::mat2 &mat) const
+    {
+        if (changed(uniform.slot, &mat[0][0], sizeof(mat)))
+            glUniformMatrix2fv(uniform.location, 1, GL_FALSE, &mat[0][0]);
+    }
+    void set(Uniform<glm::mat3> uniform, const glm::mat3 &mat) const
+    {
+        if (changed(uniform.slot, &mat[0][0], sizeof(mat)))
+            glUniformMatrix3fv(uniform.location, 1, GL_FALSE, &mat[0][0]);
+    }
+    void set(Uniform<glm::mat4> uniform, const glm::mat4 &mat) const
+    {
+        if (changed(uniform.slot, &mat[0][0], sizeof(mat)))
+            glUniformMatrix4fv(uniform.location, 1, GL_FALSE, &mat[0][0]);
+    }
+
 private:
-    void checkCompileErrors(GLuint shader, const std::string &type);
+    // active uniforms by name, open addressing with linear probing; array
+    // elements and struct members get one entry each ("lights[2].constant"),
+    // and the bare array name resolves to the same entry as "name[0]"
+    struct UniformEntry
+    {
+        GLint location;
+        GLenum type;
+
+        // last value sent to the program
+        mutable float shadow[16];
+        mutable bool shadowed;
+    };
+    mutable std::vector<UniformEntry> uniforms;
+    mutable std::vector<std::pair<std::string, int>> uniformNames; // name, index into uniforms
+    mutable std::vector<int> uniformBuckets; // index into uniformNames, -1 when empty
+
+    // submitted build, finished on first use
+    mutable bool buildPending = false;
+    mutable GLuint stages[3] = {0, 0, 0}; // vertex, fragment, geometry
+    mutable std::vector<std::pair<std::string, GLuint>> pendingBlocks;
+    mutable std::vector<std::pair<std::string, int>> pendingSamplers;
+    std::uint64_t cacheKey = 0;
+
+    void finishBuild() const;
+    void applySamplers() const;
+    static void checkCompileErrors(GLuint shader, const std::string &type);
+
+    void buildUniformTable() const;
+    const UniformEntry *findUniform(const char *name) const;
+    void checkUniformType(const char *name, GLint location, GLenum expected) const;
+
+    template <typename T>
+    Uniform<T> handleFor(const char *name) const
+    {
+        const UniformEntry *entry = findUniform(name);
+        Uniform<T> handle;
+        if (entry)
+        {
+            handle.location = entry->location;
+            handle.slot = static_cast<int>(entry - uniforms.data());
+        }
+        return handle;
+    }
+
+    // false when the uniform is inactive or already holds the value
+    bool changed(int slot, const void *value, std::size_t size) const;
+
+    static GLenum glTypeOf(const int *) { return GL_INT; }
+    static GLenum glTypeOf(const bool *) { return GL_BOOL; }
+    static GLenum glTypeOf(const float *) { return GL_FLOAT; }
+    static GLenum glTypeOf(const glm::vec2 *) { return GL_FLOAT_VEC2; }
+    static GLenum glTypeOf(const glm::vec3 *) { return GL_FLOAT_VEC3; }
+    static GLenum glTypeOf(const glm::vec4 *) { return GL_FLOAT_VEC4; }
+    static GLenum glTypeOf(const glm::mat2 *) { return GL_FLOAT_MAT2; }
+    static GLenum glTypeOf(const glm::mat3 *) { return GL_FLOAT_MAT3; }
+    static GLenum glTypeOf(const glm::mat4 *) { return GL_FLOAT_MAT4; }
 };
 
 #endif
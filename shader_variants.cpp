@@ -0,0 +1,63 @@
+#include "shader_variants.h"
+#include "material.h"
+
+std::uint32_t ShaderFeatures::key() const
+{
+    return static_cast<std::uint32_t>(pointLights) |
+           static_cast<std::uint32_t>(spotlights) << 4 |
+           (specularMap ? 1u << 8 : 0u) |
+           (fog ? 1u << 9 : 0u) |
+           (night ? 1u << 10 : 0u) |
+           (bezierSurface ? 1u << 11 : 0u) |
+           (solidColor ? 1u << 12 : 0u) |
+           (bezierTiles ? 1u << 13 : 0u);
+}
+
+std::vector<std::string> ShaderFeatures::defines() const
+{
+    std::vector<std::string> defines;
+    defines.push_back("POINT_LIGHTS " + std::to_string(pointLights));
+    defines.push_back("SPOTLIGHTS " + std::to_string(spotlights));
+    if (specularMap)
+        defines.push_back("SPECULAR_MAP");
+    if (fog)
+        defines.push_back("FOG");
+    if (night)
+        defines.push_back("NIGHT");
+    if (bezierSurface)
+        defines.push_back("BEZIER_SURFACE");
+    if (solidColor)
+        defines.push_back("SOLID_COLOR");
+    if (bezierTiles)
+        defines.push_back("BEZIER_TILES");
+    return defines;
+}
+
+ShaderVariants::ShaderVariants(const char *vertexPath, const char *fragmentPath, const char *geometryPath)
+    : vertexPath(vertexPath), fragmentPath(fragmentPath), geometryPath(geometryPath ? geometryPath : "")
+{
+}
+
+Shader &ShaderVariants::get(const ShaderFeatures &features)
+{
+    auto found = variants.find(features.key());
+    if (found != variants.end())
+        return found->second;
+
+    Shader &shader = variants.try_emplace(features.key(),
+                                          vertexPath.c_str(),
+                                          fragmentPath.c_str(),
+                                          geometryPath.empty() ? nullptr : geometryPath.c_str(),
+                                          features.defines()).first->second;
+    shader.bindUniformBlock("FrameBlock", FRAME_BLOCK_BINDING);
+    shader.bindUniformBlock("ObjectBlock", OBJECT_BLOCK_BINDING);
+    shader.bindUniformBlock("BezierBlock", BEZIER_BLOCK_BINDING);
+    Material::assignSamplers(shader);
+    return shader;
+}
+
+Shader *ShaderVariants::find(const ShaderFeatures &features)
+{
+    auto found = variants.find(features.key());
+    return found != variants.end() ? &found->second : nullptr;
+}
@@ -0,0 +1,50 @@
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "shader.h"
+#include "uniform_blocks.h"
+
+// Compile-time feature set of a lit program (see lighting.glsl)
+struct ShaderFeatures
+{
+    int pointLights = NR_LIGHTS - NR_SPOTLIGHTS;
+    int spotlights = NR_SPOTLIGHTS;
+    bool specularMap = true;
+    bool fog = true;
+    bool night = false;
+    bool bezierSurface = false;
+    bool bezierTiles = false; // with bezierSurface
+    bool solidColor = false;
+
+    std::uint32_t key() const;
+    std::vector<std::string> defines() const;
+};
+
+// Permutations of one set of stage files, each compiled the first time its
+// feature set is requested. The lit uniform blocks and the material
+// samplers are bound on creation.
+class ShaderVariants
+{
+public:
+    ShaderVariants(const char *vertexPath, const char *fragmentPath, const char *geometryPath = nullptr);
+
+    Shader &get(const ShaderFeatures &features);
+
+    // nullptr if the permutation has not been requested yet
+    Shader *find(const ShaderFeatures &features);
+
+    std::size_t size() const { return variants.size(); }
+
+private:
+    std::string vertexPath;
+    std::string fragmentPath;
+    std::string geometryPath;
+
+    std::unordered_map<std::uint32_t, Shader> variants;
+};
+
+#endif
@@ -0,0 +1,168 @@
+#include "static_batch.h"
+#include "gl_state.h"
+#include "mesh_optimizer.h"
+#include "render_queue.h"
+#include "render_stats.h"
+#include "shader.h"
+
+#include <algorithm>
+#include <map>
+#include <utility>
+
+void StaticBatch::build(const std::vector<Mesh> &meshes)
+{
+    // meshes with different layouts (e.g. skinned ones) get their own
+    // region of the vertex buffer and their own VAO
+    std::map<std::pair<VertexFormat, bool>, std::vector<const Mesh *>> partitions;
+    std::size_t largestMesh = 0;
+    for (const Mesh &mesh : meshes)
+    {
+        partitions[{mesh.layout.format, mesh.layout.skinned}].push_back(&mesh);
+        largestMesh = std::max(largestMesh, mesh.vertices.size());
+    }
+    indexType = selectIndexType(largestMesh);
+
+    std::vector<unsigned char> vertexData;
+    std::vector<unsigned int> indexData;
+    std::vector<DrawElementsIndirectCommand> commands;
+
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
+
+    for (const auto &partition : partitions)
+    {
+        const VertexLayout &layout = partition.second.front()->layout;
+        const GLsizeiptr regionOffset = static_cast<GLsizeiptr>(vertexData.size());
+
+        unsigned int VAO;
+        glGenVertexArrays(1, &VAO);
+        VAOs.push_back(VAO);
+
+        std::map<std::vector<unsigned int>, std::vector<std::pair<const Mesh *, GLint>>> materials;
+        GLint baseVertex = 0;
+        for (const Mesh *mesh : partition.second)
+        {
+            std::vector<unsigned char> packed;
+            layout.pack(mesh->vertices, packed);
+            vertexData.insert(vertexData.end(), packed.begin(), packed.end());
+
+            std::vector<unsigned int> material;
+            for (const Texture &texture : mesh->textures)
+                material.push_back(texture.id);
+            materials[material].emplace_back(mesh, baseVertex);
+
+            baseVertex += static_cast<GLint>(mesh->vertices.size());
+        }
+
+        for (const auto &material : materials)
+        {
+            Group group;
+            group.VAO = VAO;
+            group.material = material.second.front().first->material;
+            group.indirectOffset = static_cast<GLintptr>(commands.size() * sizeof(DrawElementsIndirectCommand));
+            group.boundsMin = material.second.front().first->boundsMin;
+            group.boundsMax = material.second.front().first->boundsMax;
+
+            for (const auto &entry : material.second)
+            {
+                const Mesh *mesh = entry.first;
+                group.boundsMin = glm::min(group.boundsMin, mesh->boundsMin);
+                group.boundsMax = glm::max(group.boundsMax, mesh->boundsMax);
+                const GLuint firstIndex = static_cast<GLuint>(indexData.size());
+                indexData.insert(indexData.end(), mesh->indices.begin(), mesh->indices.end());
+
+                group.counts.push_back(static_cast<GLsizei>(mesh->indices.size()));
+                group.indexOffsets.push_back(reinterpret_cast<const void *>(firstIndex * indexSize(indexType)));
+                group.baseVertices.push_back(entry.second);
+                commands.push_back({static_cast<GLuint>(mesh->indices.size()), 1, firstIndex, entry.second, 0});
+            }
+
+            groups.push_back(std::move(group));
+        }
+
+        glState.bindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        layout.apply(regionOffset);
+    }
+    glState.bindVertexArray(0);
+
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, vertexData.size(), vertexData.data(), GL_STATIC_DRAW);
+
+    std::vector<unsigned char> packedIndices;
+    packIndices(indexData, indexType, packedIndices);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, packedIndices.size(), packedIndices.data(), GL_STATIC_DRAW);
+
+    bufferBytes = vertexData.size() + packedIndices.size();
+
+    if (GLAD_GL_VERSION_4_3)
+    {
+        bufferBytes += commands.size() * sizeof(DrawElementsIndirectCommand);
+        glGenBuffers(1, &indirectBuffer);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+}
+
+MemoryUsage StaticBatch::memoryUsage() const
+{
+    MemoryUsage usage;
+    usage.cpuBytes = VAOs.capacity() * sizeof(unsigned int) + groups.capacity() * sizeof(Group);
+    for (const Group &group : groups)
+        usage.cpuBytes += group.counts.capacity() * sizeof(GLsizei) +
+                          group.indexOffsets.capacity() * sizeof(const void *) +
+                          group.baseVertices.capacity() * sizeof(GLint);
+    usage.gpuBytes = bufferBytes;
+    return usage;
+}
+
+void StaticBatch::Draw(Shader &)
+{
+    for (std::size_t i = 0; i < groups.size(); ++i)
+    {
+        groups[i].material.bind();
+        drawGroup(i);
+    }
+}
+
+void StaticBatch::collectPackets(std::size_t begin, std::size_t end, const DrawPacket &prototype,
+                                 const Frustum &frustum, std::vector<DrawPacket> &out) const
+{
+    for (std::size_t i = begin; i < end; ++i)
+    {
+        const Group &group = groups[i];
+        if (!frustum.intersects(group.boundsMin, group.boundsMax))
+            continue;
+
+        DrawPacket packet = prototype;
+        packet.kind = DrawPacket::Kind::BatchGroup;
+        packet.material = &group.material;
+        packet.center = (group.boundsMin + group.boundsMax) * 0.5f;
+        packet.batch = this;
+        packet.group = i;
+        out.push_back(packet);
+    }
+}
+
+void StaticBatch::drawGroup(std::size_t index) const
+{
+    const Group &group = groups[index];
+    glState.bindVertexArray(group.VAO);
+
+    const GLsizei drawCount = static_cast<GLsizei>(group.counts.size());
+    if (indirectBuffer)
+    {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, indexType, reinterpret_cast<const void *>(group.indirectOffset), drawCount, 0);
+    }
+    else
+        glMultiDrawElementsBaseVertex(GL_TRIANGLES, group.counts.data(), indexType,
+                                      group.indexOffsets.data(), drawCount, group.baseVertices.data());
+
+    renderStats.drawCalls++;
+    renderStats.meshDraws += drawCount;
+}
@@ -0,0 +1,64 @@
+#ifndef STATIC_BATCH_H
+#define STATIC_BATCH_H
+#include <vector>
+#include <glad/glad.h>
+
+#include "mesh.h"
+
+struct DrawPacket;
+struct Frustum;
+class Shader;
+
+// All meshes of a model packed into one vertex/index buffer pair and drawn
+// with one multi-draw per material.
+class StaticBatch
+{
+public:
+    void build(const std::vector<Mesh> &meshes);
+
+    bool empty() const { return groups.empty(); }
+
+    void Draw(Shader &shader);
+
+    std::size_t groupCount() const { return groups.size(); }
+
+    // one packet per group in [begin, end) that intersects the frustum
+    void collectPackets(std::size_t begin, std::size_t end, const DrawPacket &prototype,
+                        const Frustum &frustum, std::vector<DrawPacket> &out) const;
+
+    // binds the group's VAO and issues its multi-draw; the caller binds
+    // the group's material
+    void drawGroup(std::size_t group) const;
+
+    MemoryUsage memoryUsage() const;
+
+private:
+    struct DrawElementsIndirectCommand
+    {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+
+    // meshes sharing a vertex layout and a set of textures
+    struct Group
+    {
+        unsigned int VAO;
+        Material material;
+        std::vector<GLsizei> counts;
+        std::vector<const void *> indexOffsets;
+        std::vector<GLint> baseVertices;
+        GLintptr indirectOffset;
+        glm::vec3 boundsMin, boundsMax;
+    };
+
+    unsigned int VBO = 0, EBO = 0, indirectBuffer = 0;
+    GLenum indexType = GL_UNSIGNED_INT; // indices are relative to each mesh's base vertex
+    std::size_t bufferBytes = 0;
+    std::vector<unsigned int> VAOs;
+    std::vector<Group> groups;
+};
+
+#endif
@@ -0,0 +1,120 @@
+#include "stream_buffer.h"
+
+#include <iostream>
+
+namespace
+{
+    const GLuint64 FENCE_TIMEOUT_NS = 1000000; // between checks, 1 ms
+}
+
+StreamBuffer::StreamBuffer(GLenum target, std::size_t regionBytes, int regionCount)
+    : target(target), regionSize(regionBytes), regionCount(regionCount)
+{
+    allocate();
+}
+
+void StreamBuffer::allocate()
+{
+    glGenBuffers(1, &ID);
+    glBindBuffer(target, ID);
+
+    if (GLAD_GL_VERSION_4_4)
+    {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(target, regionSize * regionCount, nullptr, flags);
+        mapped = static_cast<unsigned char *>(glMapBufferRange(target, 0, regionSize * regionCount, flags));
+        if (!mapped)
+            std::cerr << "\n[Persistent mapping failed] " << glGetError() << '\n';
+    }
+
+    if (mapped)
+        fences.assign(regionCount, nullptr);
+    else
+    {
+        // immutable storage cannot be orphaned, so a failed mapping starts over
+        if (GLAD_GL_VERSION_4_4)
+        {
+            glDeleteBuffers(1, &ID);
+            glGenBuffers(1, &ID);
+            glBindBuffer(target, ID);
+        }
+        glBufferData(target, regionSize, nullptr, GL_STREAM_DRAW);
+    }
+
+    glBindBuffer(target, 0);
+}
+
+void *StreamBuffer::map()
+{
+    if (!mapped)
+    {
+        // a fresh allocation: the driver keeps the old one until the GPU is done with it
+        glBindBuffer(target, ID);
+        glBufferData(target, regionSize, nullptr, GL_STREAM_DRAW);
+        void *data = glMapBufferRange(target, 0, regionSize, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        orphanMapped = data != nullptr;
+        return data;
+    }
+
+    region = (region + 1) % static_cast<int>(fences.size());
+
+    GLsync &sync = fences[region];
+    if (sync)
+    {
+        while (glClientWaitSync(sync, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NS) == GL_TIMEOUT_EXPIRED)
+            ;
+        glDeleteSync(sync);
+        sync = nullptr;
+    }
+    return mapped + region * regionSize;
+}
+
+std::size_t StreamBuffer::unmap()
+{
+    if (!mapped)
+    {
+        if (orphanMapped)
+        {
+            glBindBuffer(target, ID);
+            if (!glUnmapBuffer(target))
+                std::cerr << "\n[Stream buffer contents lost]\n";
+            orphanMapped = false;
+        }
+        return 0;
+    }
+
+    // coherent mapping: the writes are visible without a flush
+    return region * regionSize;
+}
+
+void StreamBuffer::fence()
+{
+    if (!mapped || region < 0)
+        return;
+
+    if (fences[region])
+        glDeleteSync(fences[region]);
+    fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void StreamBuffer::resize(std::size_t regionBytes)
+{
+    // the driver keeps a deleted buffer alive until pending draws are done
+    for (GLsync sync : fences)
+        if (sync)
+            glDeleteSync(sync);
+    fences.clear();
+
+    if (mapped)
+    {
+        glBindBuffer(target, ID);
+        glUnmapBuffer(target);
+        glBindBuffer(target, 0);
+        mapped = nullptr;
+    }
+    glDeleteBuffers(1, &ID);
+
+    regionSize = regionBytes;
+    region = -1;
+    allocate();
+}
@@ -0,0 +1,51 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+#include <cstddef>
+#include <vector>
+#include <glad/glad.h>
+
+// A buffer for data rewritten every frame, split into a ring of equal
+// regions used in turn. With GL 4.4 the storage is mapped persistently
+// and every region is fenced, so the CPU fills the next region while the
+// GPU still reads the previous ones. Otherwise the whole buffer is
+// orphaned on every write and only the first region is used.
+class StreamBuffer
+{
+public:
+    StreamBuffer(GLenum target, std::size_t regionBytes, int regionCount = 3);
+
+    StreamBuffer(const StreamBuffer &) = delete;
+    StreamBuffer &operator=(const StreamBuffer &) = delete;
+
+    // waits until the GPU has released the next region and returns it for
+    // writing up to regionBytes(); nullptr if the buffer cannot be mapped
+    void *map();
+
+    // ends the write and returns the region's byte offset in the buffer
+    std::size_t unmap();
+
+    // call once the draws reading the last unmapped region are issued
+    void fence();
+
+    // a new buffer with another region size; the old contents are dropped
+    // and the GL name changes
+    void resize(std::size_t regionBytes);
+
+    GLuint id() const { return ID; }
+    std::size_t regionBytes() const { return regionSize; }
+    bool persistent() const { return mapped != nullptr; }
+
+private:
+    GLuint ID = 0;
+    GLenum target;
+    std::size_t regionSize;
+    int regionCount;
+    unsigned char *mapped = nullptr; // whole buffer, persistent path only
+    std::vector<GLsync> fences;      // per region, 0 when free
+    int region = -1;                 // the region last returned by map()
+    bool orphanMapped = false;       // orphaning path: map() succeeded
+
+    void allocate();
+};
+
+#endif
@@ -0,0 +1,480 @@
+#include "texture_cook.h"
+#include "thread_pool.h"
+#include "stb_image.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+namespace
+{
+    const unsigned char KTX_IDENTIFIER[12] = {0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'};
+    const std::uint32_t KTX_ENDIANNESS = 0x04030201;
+
+    struct KtxHeader
+    {
+        unsigned char identifier[12];
+        std::uint32_t endianness;
+        std::uint32_t glType;
+        std::uint32_t glTypeSize;
+        std::uint32_t glFormat;
+        std::uint32_t glInternalFormat;
+        std::uint32_t glBaseInternalFormat;
+        std::uint32_t pixelWidth;
+        std::uint32_t pixelHeight;
+        std::uint32_t pixelDepth;
+        std::uint32_t numberOfArrayElements;
+        std::uint32_t numberOfFaces;
+        std::uint32_t numberOfMipmapLevels;
+        std::uint32_t bytesOfKeyValueData;
+    };
+
+    int blockBytes(unsigned int internalFormat)
+    {
+        switch (internalFormat)
+        {
+        case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+            return 8;
+        case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+        case GL_COMPRESSED_RG_RGTC2:
+        case GL_COMPRESSED_RGBA_BPTC_UNORM:
+            return 16;
+        default:
+            return 0;
+        }
+    }
+
+    std::size_t levelSize(unsigned int internalFormat, int width, int height)
+    {
+        return static_cast<std::size_t>((width + 3) / 4) * ((height + 3) / 4) * blockBytes(internalFormat);
+    }
+
+    unsigned short pack565(int r, int g, int b)
+    {
+        return static_cast<unsigned short>(((r * 31 + 127) / 255) << 11 | ((g * 63 + 127) / 255) << 5 | ((b * 31 + 127) / 255));
+    }
+
+    void unpack565(unsigned short c, int rgb[3])
+    {
+        int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+        rgb[0] = (r << 3) | (r >> 2);
+        rgb[1] = (g << 2) | (g >> 4);
+        rgb[2] = (b << 3) | (b >> 2);
+    }
+
+    void writeLE16(unsigned char *out, unsigned short value)
+    {
+        out[0] = static_cast<unsigned char>(value & 0xFF);
+        out[1] = static_cast<unsigned char>(value >> 8);
+    }
+
+    // BC1 colour block: inset bounding box along the dominant diagonal
+    void encodeColorBlock(const unsigned char block[16][4], unsigned char *out)
+    {
+        int lo[3] = {255, 255, 255}, hi[3] = {0, 0, 0};
+        for (int p = 0; p < 16; ++p)
+            for (int c = 0; c < 3; ++c)
+            {
+                lo[c] = std::min(lo[c], (int)block[p][c]);
+                hi[c] = std::max(hi[c], (int)block[p][c]);
+            }
+
+        for (int c = 0; c < 3; ++c)
+        {
+            int inset = (hi[c] - lo[c]) >> 4;
+            lo[c] += inset;
+            hi[c] -= inset;
+        }
+
+        // flip green/blue so the box diagonal follows the colour distribution
+        int center[3] = {(lo[0] + hi[0]) / 2, (lo[1] + hi[1]) / 2, (lo[2] + hi[2]) / 2};
+        int covRG = 0, covRB = 0;
+        for (int p = 0; p < 16; ++p)
+        {
+            int r = block[p][0] - center[0];
+            covRG += r * (block[p][1] - center[1]);
+            covRB += r * (block[p][2] - center[2]);
+        }
+        if (covRG < 0)
+            std::swap(lo[1], hi[1]);
+        if (covRB < 0)
+            std::swap(lo[2], hi[2]);
+
+        unsigned short c0 = pack565(hi[0], hi[1], hi[2]);
+        unsigned short c1 = pack565(lo[0], lo[1], lo[2]);
+        if (c0 < c1)
+            std::swap(c0, c1);
+
+        writeLE16(out, c0);
+        writeLE16(out + 2, c1);
+
+        std::uint32_t indices = 0;
+        if (c0 != c1)
+        {
+            int palette[4][3];
+            unpack565(c0, palette[0]);
+            unpack565(c1, palette[1]);
+            for (int c = 0; c < 3; ++c)
+            {
+                palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+            }
+
+            for (int p = 0; p < 16; ++p)
+            {
+                int best = 0, bestDist = 1 << 30;
+                for (int i = 0; i < 4; ++i)
+                {
+                    int dr = block[p][0] - palette[i][0];
+                    int dg = block[p][1] - palette[i][1];
+                    int db = block[p][2] - palette[i][2];
+                    int dist = dr * dr + dg * dg + db * db;
+                    if (dist < bestDist)
+                    {
+                        bestDist = dist;
+                        best = i;
+                    }
+                }
+                indices |= static_cast<std::uint32_t>(best) << (2 * p);
+            }
+        }
+
+        for (int i = 0; i < 4; ++i)
+            out[4 + i] = static_cast<unsigned char>(indices >> (8 * i));
+    }
+
+    // BC4 single-channel block, as used for BC3 alpha and both BC5 channels
+    void encodeChannelBlock(const unsigned char block[16][4], int channel, unsigned char *out)
+    {
+        int lo = 255, hi = 0;
+        for (int p = 0; p < 16; ++p)
+        {
+            lo = std::min(lo, (int)block[p][channel]);
+            hi = std::max(hi, (int)block[p][channel]);
+        }
+
+        out[0] = static_cast<unsigned char>(hi);
+        out[1] = static_cast<unsigned char>(lo);
+
+        std::uint64_t indices = 0;
+        if (hi != lo)
+        {
+            int palette[8] = {hi, lo};
+            for (int i = 1; i < 7; ++i)
+                palette[i + 1] = ((7 - i) * hi + i * lo) / 7;
+
+            for (int p = 0; p < 16; ++p)
+            {
+                int best = 0, bestDist = 256;
+                for (int i = 0; i < 8; ++i)
+                {
+                    int dist = std::abs(block[p][channel] - palette[i]);
+                    if (dist < bestDist)
+                    {
+                        bestDist = dist;
+                        best = i;
+                    }
+                }
+                indices |= static_cast<std::uint64_t>(best) << (3 * p);
+            }
+        }
+
+        for (int i = 0; i < 6; ++i)
+            out[2 + i] = static_cast<unsigned char>(indices >> (8 * i));
+    }
+
+    void encodeLevel(const std::vector<unsigned char> &rgba, int width, int height,
+                     unsigned int internalFormat, std::vector<unsigned char> &out)
+    {
+        const int bytes = blockBytes(internalFormat);
+        out.resize(levelSize(internalFormat, width, height));
+
+        unsigned char *dst = out.data();
+        unsigned char block[16][4];
+        for (int by = 0; by < height; by += 4)
+        {
+            for (int bx = 0; bx < width; bx += 4)
+            {
+                // edge blocks repeat the last row/column
+                for (int p = 0; p < 16; ++p)
+                {
+                    int x = std::min(bx + (p & 3), width - 1);
+                    int y = std::min(by + (p >> 2), height - 1);
+                    std::memcpy(block[p], &rgba[(static_cast<std::size_t>(y) * width + x) * 4], 4);
+                }
+
+                if (internalFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT)
+                    encodeColorBlock(block, dst);
+                else if (internalFormat == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT)
+                {
+                    encodeChannelBlock(block, 3, dst);
+                    encodeColorBlock(block, dst + 8);
+                }
+                else if (internalFormat == GL_COMPRESSED_RG_RGTC2)
+                {
+                    encodeChannelBlock(block, 0, dst);
+                    encodeChannelBlock(block, 1, dst + 8);
+                }
+                dst += bytes;
+            }
+        }
+    }
+
+    void downsample(std::vector<unsigned char> &rgba, int &width, int &height)
+    {
+        int newWidth = std::max(1, width / 2);
+        int newHeight = std::max(1, height / 2);
+        std::vector<unsigned char> result(static_cast<std::size_t>(newWidth) * newHeight * 4);
+
+        for (int y = 0; y < newHeight; ++y)
+            for (int x = 0; x < newWidth; ++x)
+            {
+                int x0 = std::min(2 * x, width - 1), x1 = std::min(2 * x + 1, width - 1);
+                int y0 = std::min(2 * y, height - 1), y1 = std::min(2 * y + 1, height - 1);
+                for (int c = 0; c < 4; ++c)
+                {
+                    int sum = rgba[(static_cast<std::size_t>(y0) * width + x0) * 4 + c] +
+                              rgba[(static_cast<std::size_t>(y0) * width + x1) * 4 + c] +
+                              rgba[(static_cast<std::size_t>(y1) * width + x0) * 4 + c] +
+                              rgba[(static_cast<std::size_t>(y1) * width + x1) * 4 + c];
+                    result[(static_cast<std::size_t>(y) * newWidth + x) * 4 + c] = static_cast<unsigned char>((sum + 2) / 4);
+                }
+            }
+
+        rgba.swap(result);
+        width = newWidth;
+        height = newHeight;
+    }
+}
+
+std::string cookedPath(const std::string &filename)
+{
+    return filename + ".ktx";
+}
+
+bool readKtx(const std::string &path, CompressedImage &image, int maxSize)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    KtxHeader header;
+    if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+        std::memcmp(header.identifier, KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER)) != 0 ||
+        header.endianness != KTX_ENDIANNESS ||
+        header.glType != 0 ||
+        blockBytes(header.glInternalFormat) == 0 ||
+        header.pixelDepth != 0 || header.numberOfArrayElements != 0 || header.numberOfFaces != 1 ||
+        header.numberOfMipmapLevels == 0)
+        return false;
+
+    // checked before anything is allocated from the header
+    const std::uint32_t limit = static_cast<std::uint32_t>(std::max(maxSize, 0));
+    if (header.pixelWidth == 0 || header.pixelHeight == 0 ||
+        header.pixelWidth > limit || header.pixelHeight > limit)
+        return false;
+
+    std::uint32_t fullChain = 1;
+    for (std::uint32_t size = std::max(header.pixelWidth, header.pixelHeight); size > 1; size /= 2)
+        ++fullChain;
+    if (header.numberOfMipmapLevels > fullChain)
+        return false;
+
+    file.seekg(header.bytesOfKeyValueData, std::ios::cur);
+
+    image.internalFormat = header.glInternalFormat;
+    image.baseFormat = header.glBaseInternalFormat;
+    image.width = static_cast<int>(header.pixelWidth);
+    image.height = static_cast<int>(header.pixelHeight);
+    image.levels.resize(header.numberOfMipmapLevels);
+
+    int width = image.width, height = image.height;
+    for (std::vector<unsigned char> &level : image.levels)
+    {
+        std::uint32_t imageSize;
+        if (!file.read(reinterpret_cast<char *>(&imageSize), sizeof(imageSize)) ||
+            imageSize != levelSize(image.internalFormat, width, height))
+            return false;
+
+        level.resize(imageSize);
+        if (!file.read(reinterpret_cast<char *>(level.data()), imageSize))
+            return false;
+        file.seekg(3 - ((imageSize + 3) % 4), std::ios::cur);
+
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+    }
+
+    return true;
+}
+
+unsigned int srgbFormat(unsigned int internalFormat)
+{
+    switch (internalFormat)
+    {
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+        return GL_COMPRESSED_SRGB_S3TC_DXT1_EXT;
+    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+        return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
+    case GL_COMPRESSED_RGBA_BPTC_UNORM:
+        return GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM;
+    default:
+        return internalFormat;
+    }
+}
+
+bool writeKtx(const std::string &path, const CompressedImage &image)
+{
+    KtxHeader header = {};
+    std::memcpy(header.identifier, KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER));
+    header.endianness = KTX_ENDIANNESS;
+    header.glTypeSize = 1;
+    header.glInternalFormat = image.internalFormat;
+    header.glBaseInternalFormat = image.baseFormat;
+    header.pixelWidth = static_cast<std::uint32_t>(image.width);
+    header.pixelHeight = static_cast<std::uint32_t>(image.height);
+    header.numberOfFaces = 1;
+    header.numberOfMipmapLevels = static_cast<std::uint32_t>(image.levels.size());
+
+    const std::string tmpPath = path + ".tmp";
+    std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    for (const std::vector<unsigned char> &level : image.levels)
+    {
+        static const char padding[3] = {};
+        std::uint32_t imageSize = static_cast<std::uint32_t>(level.size());
+        file.write(reinterpret_cast<const char *>(&imageSize), sizeof(imageSize));
+        file.write(reinterpret_cast<const char *>(level.data()), level.size());
+        file.write(padding, 3 - ((imageSize + 3) % 4));
+    }
+    file.close();
+
+    if (!file || std::rename(tmpPath.c_str(), path.c_str()) != 0)
+    {
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+void compressImage(const unsigned char *pixels, int width, int height, int nrComponents, CompressedImage &image)
+{
+    std::vector<unsigned char> rgba(static_cast<std::size_t>(width) * height * 4);
+    bool opaque = true;
+    for (std::size_t i = 0; i < static_cast<std::size_t>(width) * height; ++i)
+    {
+        const unsigned char *src = pixels + i * nrComponents;
+        unsigned char *dst = &rgba[i * 4];
+        if (nrComponents >= 3)
+        {
+            dst[0] = src[0];
+            dst[1] = src[1];
+            dst[2] = src[2];
+            dst[3] = nrComponents == 4 ? src[3] : 255;
+        }
+        else
+        {
+            // matches a GL_RED / GL_RG upload of the raw image
+            dst[0] = src[0];
+            dst[1] = nrComponents == 2 ? src[1] : 0;
+            dst[2] = 0;
+            dst[3] = 255;
+        }
+        opaque = opaque && dst[3] == 255;
+    }
+
+    if (nrComponents <= 2)
+    {
+        image.internalFormat = GL_COMPRESSED_RG_RGTC2;
+        image.baseFormat = GL_RG;
+    }
+    else if (opaque)
+    {
+        image.internalFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        image.baseFormat = GL_RGB;
+    }
+    else
+    {
+        image.internalFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        image.baseFormat = GL_RGBA;
+    }
+
+    image.width = width;
+    image.height = height;
+    image.levels.clear();
+
+    for (;;)
+    {
+        image.levels.emplace_back();
+        encodeLevel(rgba, width, height, image.internalFormat, image.levels.back());
+        if (width == 1 && height == 1)
+            break;
+        downsample(rgba, width, height);
+    }
+}
+
+bool cookTexture(const std::string &filename, bool flipVertically)
+{
+    stbi_set_flip_vertically_on_load_thread(flipVertically);
+
+    int width, height, nrComponents;
+    unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
+    if (!data)
+    {
+        std::cerr << "\n[Texture cook failed to read] " << filename << '\n';
+        return false;
+    }
+
+    CompressedImage image;
+    compressImage(data, width, height, nrComponents, image);
+    stbi_image_free(data);
+
+    if (!writeKtx(cookedPath(filename), image))
+    {
+        std::cerr << "\n[Texture cook failed to write] " << cookedPath(filename) << '\n';
+        return false;
+    }
+    return true;
+}
+
+int cookTextures(const std::vector<std::string> &materialDirectories, const std::vector<std::string> &cubemapFaces)
+{
+    std::vector<std::pair<std::string, bool>> files;
+    for (const std::string &directory : materialDirectories)
+    {
+        std::error_code ec;
+        for (std::filesystem::recursive_directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec))
+        {
+            std::string extension = it->path().extension().string();
+            std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+            if (it->is_regular_file() && (extension == ".jpg" || extension == ".jpeg" || extension == ".png"))
+                files.emplace_back(it->path().string(), true);
+        }
+    }
+    for (const std::string &face : cubemapFaces)
+        files.emplace_back(face, false);
+
+    std::atomic<int> failures(0);
+    ThreadPool &pool = ThreadPool::shared();
+    for (const auto &file : files)
+    {
+        pool.submit([&file, &failures]()
+        {
+            if (cookTexture(file.first, file.second))
+                std::cout << "[Cooked] " << cookedPath(file.first) + '\n';
+            else
+                ++failures;
+        });
+    }
+    pool.wait();
+
+    return failures;
+}
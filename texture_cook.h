@@ -0,0 +1,52 @@
+#ifndef TEXTURE_COOK_H
+#define TEXTURE_COOK_H
+#include <string>
+#include <vector>
+
+// Offline texture cooking: images are transcoded to BCn with a full mip
+// chain and stored as KTX 1.1 files next to the source ("<image>.ktx").
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+struct CompressedImage
+{
+    unsigned int internalFormat = 0; // BC1, BC3, BC5 or BC7 GL enum
+    unsigned int baseFormat = 0;
+    int width = 0;
+    int height = 0;
+    std::vector<std::vector<unsigned char>> levels;
+};
+
+std::string cookedPath(const std::string &filename);
+
+// false for files that are not BCn, or whose size is zero, above `maxSize`
+// or claims more levels than a full mip chain
+bool readKtx(const std::string &path, CompressedImage &image, int maxSize);
+bool writeKtx(const std::string &path, const CompressedImage &image);
+
+// the sRGB variant of a cooked format; formats without one (BC5) are
+// returned unchanged and stay linear, as one- and two-channel images do
+unsigned int srgbFormat(unsigned int internalFormat);
+
+// BC1 for opaque RGB, BC3 when alpha is used, BC5 for one- and two-channel
+// images. Pixels are 8 bits per channel with `nrComponents` channels.
+void compressImage(const unsigned char *pixels, int width, int height, int nrComponents, CompressedImage &image);
+
+bool cookTexture(const std::string &filename, bool flipVertically);
+
+// Cooks every .jpg/.png below the material directories (flipped, as models
+// load them) and the cubemap faces (unflipped). Returns the failure count.
+int cookTextures(const std::vector<std::string> &materialDirectories, const std::vector<std::string> &cubemapFaces);
+
+#endif
@@ -0,0 +1,208 @@
+#include "texture_loader.h"
+#include "thread_pool.h"
+#include "stb_image.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+
+namespace
+{
+    double millisecondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+DecodedImage::~DecodedImage()
+{
+    stbi_image_free(data);
+}
+
+std::vector<int> queryCompressedFormats()
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &count);
+
+    std::vector<int> formats(count);
+    if (count > 0)
+        glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, formats.data());
+    return formats;
+}
+
+int queryMaxTextureSize()
+{
+    GLint size = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &size);
+    return size;
+}
+
+bool decodeImage(const std::string &filename, DecodedImage &image, const std::vector<int> &compressedFormats, int maxTextureSize,
+                 bool gamma)
+{
+    std::error_code ec;
+    const std::string cooked = cookedPath(filename);
+    auto cookedTime = std::filesystem::last_write_time(cooked, ec);
+    if (!ec && !(cookedTime < std::filesystem::last_write_time(filename, ec)) && !ec &&
+        readKtx(cooked, image.compressed, maxTextureSize))
+    {
+        if (gamma)
+            image.compressed.internalFormat = srgbFormat(image.compressed.internalFormat);
+
+        if (std::find(compressedFormats.begin(), compressedFormats.end(),
+                      static_cast<int>(image.compressed.internalFormat)) != compressedFormats.end())
+        {
+            image.width = image.compressed.width;
+            image.height = image.compressed.height;
+            return true;
+        }
+        image.compressed = CompressedImage();
+    }
+
+    image.data = stbi_load(filename.c_str(), &image.width, &image.height, &image.nrComponents, 0);
+    return image.data != nullptr;
+}
+
+void uploadImage(unsigned int target, const DecodedImage &image, bool gamma)
+{
+    if (image.isCompressed())
+    {
+        const CompressedImage &compressed = image.compressed;
+        int width = compressed.width, height = compressed.height;
+        for (std::size_t level = 0; level < compressed.levels.size(); ++level)
+        {
+            glCompressedTexImage2D(target, static_cast<GLint>(level), compressed.internalFormat, width, height, 0,
+                                   static_cast<GLsizei>(compressed.levels[level].size()), compressed.levels[level].data());
+            width = std::max(1, width / 2);
+            height = std::max(1, height / 2);
+        }
+        return;
+    }
+
+    GLenum format = GL_RGB;
+    if (image.nrComponents == 1)
+        format = GL_RED;
+    else if (image.nrComponents == 2)
+        format = GL_RG;
+    else if (image.nrComponents == 3)
+        format = GL_RGB;
+    else if (image.nrComponents == 4)
+        format = GL_RGBA;
+
+    GLenum internalFormat = format;
+    if (gamma && format == GL_RGB)
+        internalFormat = GL_SRGB8;
+    else if (gamma && format == GL_RGBA)
+        internalFormat = GL_SRGB8_ALPHA8;
+
+    glTexImage2D(target, 0, internalFormat, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.data);
+}
+
+void uploadTexture2D(unsigned int textureID, const DecodedImage &image, bool gamma)
+{
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    uploadImage(GL_TEXTURE_2D, image, gamma);
+
+    if (image.isCompressed())
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(image.compressed.levels.size()) - 1);
+    else
+        glGenerateMipmap(GL_TEXTURE_2D);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+TextureLoader::TextureLoader(ThreadPool &pool)
+    : pool(pool), compressedFormats(queryCompressedFormats()), maxTextureSize(queryMaxTextureSize())
+{
+}
+
+TextureLoader::~TextureLoader()
+{
+    finish();
+}
+
+void TextureLoader::enqueue(unsigned int textureID, const std::string &filename, bool gamma)
+{
+    if (jobs.empty())
+        firstEnqueue = std::chrono::steady_clock::now();
+
+    jobs.push_back(std::make_unique<Job>());
+    Job *job = jobs.back().get();
+    job->textureID = textureID;
+    job->filename = filename;
+    job->gamma = gamma;
+
+    pool.submit([this, job]()
+    {
+        auto start = std::chrono::steady_clock::now();
+        decodeImage(job->filename, job->image, compressedFormats, maxTextureSize, job->gamma);
+        job->decodeMs = millisecondsSince(start);
+        job->cooked = job->image.isCompressed();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        ready.push_back(job);
+        jobDecoded.notify_one();
+    });
+}
+
+void TextureLoader::finish()
+{
+    if (jobs.empty())
+        return;
+
+    for (std::size_t uploaded = 0; uploaded < jobs.size(); ++uploaded)
+    {
+        Job *job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            jobDecoded.wait(lock, [this]() { return !ready.empty(); });
+            job = ready.back();
+            ready.pop_back();
+        }
+
+        if (job->image.data || job->image.isCompressed())
+        {
+            auto uploadStart = std::chrono::steady_clock::now();
+            uploadTexture2D(job->textureID, job->image, job->gamma);
+            job->uploadMs = millisecondsSince(uploadStart);
+        }
+        else
+        {
+            std::cout << "Texture failed to load at path: " << job->filename << std::endl;
+        }
+
+        stbi_image_free(job->image.data);
+        job->image.data = nullptr;
+        job->image.compressed = CompressedImage();
+    }
+
+    double decodeTotal = 0.0;
+    double uploadTotal = 0.0;
+
+    std::ios format(nullptr);
+    format.copyfmt(std::cout);
+    std::cout << std::fixed << std::setprecision(2);
+    for (const auto &job : jobs)
+    {
+        std::cout << "[Texture] " << job->filename
+                  << (job->cooked ? " (cooked)" : "")
+                  << " decode " << job->decodeMs << " ms"
+                  << " upload " << job->uploadMs << " ms\n";
+        decodeTotal += job->decodeMs;
+        uploadTotal += job->uploadMs;
+    }
+    std::cout << "[Texture] " << jobs.size() << " textures on " << pool.size() << " threads:"
+              << " decode " << decodeTotal << " ms (sum)"
+              << " upload " << uploadTotal << " ms"
+              << " wall " << millisecondsSince(firstEnqueue) << " ms" << std::endl;
+    std::cout.copyfmt(format);
+
+    jobs.clear();
+}
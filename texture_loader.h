@@ -0,0 +1,88 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "texture_cook.h"
+
+class ThreadPool;
+
+struct DecodedImage
+{
+    unsigned char *data = nullptr;
+    int width = 0;
+    int height = 0;
+    int nrComponents = 0;
+
+    // filled instead of `data` when an up-to-date cooked file was found
+    CompressedImage compressed;
+
+    bool isCompressed() const { return !compressed.levels.empty(); }
+
+    DecodedImage() = default;
+    DecodedImage(const DecodedImage &) = delete;
+    DecodedImage &operator=(const DecodedImage &) = delete;
+    ~DecodedImage();
+};
+
+// GL thread only; compressed formats the driver can sample from.
+std::vector<int> queryCompressedFormats();
+
+// GL thread only; GL_MAX_TEXTURE_SIZE.
+int queryMaxTextureSize();
+
+// Safe to call from any thread. Prefers "<filename>.ktx" when it is not
+// older than the image, its format (the sRGB variant with `gamma`) is in
+// `compressedFormats` and neither side exceeds `maxTextureSize`.
+bool decodeImage(const std::string &filename, DecodedImage &image,
+                 const std::vector<int> &compressedFormats = std::vector<int>(), int maxTextureSize = 0,
+                 bool gamma = false);
+
+// GL thread only; uploads every level of the image to the bound texture,
+// three- and four-channel images as sRGB with `gamma`.
+void uploadImage(unsigned int target, const DecodedImage &image, bool gamma = false);
+
+// GL thread only; the texture object must already exist.
+void uploadTexture2D(unsigned int textureID, const DecodedImage &image, bool gamma);
+
+// Decodes images on a thread pool and uploads them on the calling (GL)
+// thread as soon as each one is ready.
+class TextureLoader
+{
+public:
+    explicit TextureLoader(ThreadPool &pool);
+    ~TextureLoader();
+
+    void enqueue(unsigned int textureID, const std::string &filename, bool gamma = false);
+
+    // uploads every enqueued texture, then prints per-texture timings
+    void finish();
+
+private:
+    struct Job
+    {
+        unsigned int textureID;
+        std::string filename;
+        bool gamma;
+        DecodedImage image;
+        bool cooked = false;
+        double decodeMs = 0.0;
+        double uploadMs = 0.0;
+    };
+
+    ThreadPool &pool;
+    std::vector<int> compressedFormats;
+    int maxTextureSize;
+    std::vector<std::unique_ptr<Job>> jobs;
+    std::vector<Job *> ready;
+    std::chrono::steady_clock::time_point firstEnqueue;
+    std::mutex mutex;
+    std::condition_variable jobDecoded;
+};
+
+#endif
@@ -0,0 +1,53 @@
+#include "texture_registry.h"
+
+#include <glad/glad.h>
+
+#include <filesystem>
+#include <system_error>
+
+TextureResource::~TextureResource()
+{
+    TextureRegistry::instance().release(*this);
+}
+
+TextureRegistry &TextureRegistry::instance()
+{
+    static TextureRegistry registry;
+    return registry;
+}
+
+TextureHandle TextureRegistry::acquire(const std::string &filename, bool gamma, bool &created)
+{
+    std::error_code ec;
+    std::filesystem::path canonical = std::filesystem::weakly_canonical(std::filesystem::absolute(filename), ec);
+    Key key{ec ? filename : canonical.string(), gamma};
+
+    auto it = textures.find(key);
+    if (it != textures.end())
+    {
+        if (TextureHandle texture = it->second.lock())
+        {
+            created = false;
+            return texture;
+        }
+    }
+
+    TextureHandle texture = std::make_shared<TextureResource>();
+    glGenTextures(1, &texture->id);
+    texture->path = key.path;
+    texture->gamma = gamma;
+
+    textures[key] = texture;
+    created = true;
+    return texture;
+}
+
+void TextureRegistry::release(TextureResource &texture)
+{
+    auto it = textures.find(Key{texture.path, texture.gamma});
+    if (it != textures.end() && it->second.expired())
+        textures.erase(it);
+
+    if (contextAlive && texture.id)
+        glDeleteTextures(1, &texture.id);
+}
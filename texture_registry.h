@@ -0,0 +1,64 @@
+#ifndef TEXTURE_REGISTRY_H
+#define TEXTURE_REGISTRY_H
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+// A GL texture shared by every model and mesh that references the same
+// image. The texture is deleted when the last handle goes away.
+struct TextureResource
+{
+    unsigned int id = 0;
+    std::string path; // canonical absolute path
+    bool gamma = false;
+
+    ~TextureResource();
+};
+
+typedef std::shared_ptr<TextureResource> TextureHandle;
+
+// Process-wide texture cache keyed by canonical path and gamma flag.
+// GL thread only.
+class TextureRegistry
+{
+public:
+    static TextureRegistry &instance();
+
+    // Returns the texture for the file. When `created` is set the texture
+    // object is new and empty, and the caller is responsible for uploading it.
+    TextureHandle acquire(const std::string &filename, bool gamma, bool &created);
+
+    std::size_t size() const { return textures.size(); }
+
+    // called before the GL context goes away; handles released afterwards
+    // no longer touch GL
+    void shutdown() { contextAlive = false; }
+
+private:
+    friend struct TextureResource;
+
+    struct Key
+    {
+        std::string path;
+        bool gamma;
+
+        bool operator==(const Key &other) const { return gamma == other.gamma && path == other.path; }
+    };
+
+    struct KeyHash
+    {
+        std::size_t operator()(const Key &key) const
+        {
+            return std::hash<std::string>()(key.path) ^ static_cast<std::size_t>(key.gamma);
+        }
+    };
+
+    std::unordered_map<Key, std::weak_ptr<TextureResource>, KeyHash> textures;
+    bool contextAlive = true;
+
+    TextureRegistry() = default;
+    void release(TextureResource &texture);
+};
+
+#endif
@@ -0,0 +1,126 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+    if (threadCount == 0)
+        threadCount = 1;
+
+    workers.reserve(threadCount);
+    for (unsigned int i = 0; i < threadCount; ++i)
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    taskAvailable.notify_all();
+
+    for (std::thread &worker : workers)
+        worker.join();
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(task));
+        ++pending;
+    }
+    taskAvailable.notify_one();
+}
+
+void ThreadPool::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    allDone.wait(lock, [this]() { return pending == 0; });
+}
+
+void ThreadPool::parallelFor(std::size_t count, std::size_t grain,
+                             const std::function<void(std::size_t, std::size_t)> &body)
+{
+    if (count == 0)
+        return;
+    grain = std::max<std::size_t>(grain, 1);
+
+    const std::size_t chunkCount = (count + grain - 1) / grain;
+    if (chunkCount == 1)
+    {
+        body(0, count);
+        return;
+    }
+
+    struct Range
+    {
+        std::atomic<std::size_t> nextChunk{0};
+        std::size_t finishedChunks = 0;
+        std::mutex mutex;
+        std::condition_variable done;
+    };
+    auto range = std::make_shared<Range>();
+
+    // `body` lives on the caller's stack, which outlives every chunk: the
+    // caller returns only after all chunks are finished, and helpers that
+    // start later find no chunk left and never touch it
+    auto runChunks = [range, chunkCount, count, grain, &body]()
+    {
+        std::size_t chunk;
+        while ((chunk = range->nextChunk.fetch_add(1)) < chunkCount)
+        {
+            body(chunk * grain, std::min(count, (chunk + 1) * grain));
+
+            std::lock_guard<std::mutex> lock(range->mutex);
+            if (++range->finishedChunks == chunkCount)
+                range->done.notify_all();
+        }
+    };
+
+    const std::size_t helpers = std::min<std::size_t>(size(), chunkCount - 1);
+    for (std::size_t i = 0; i < helpers; ++i)
+        submit(runChunks);
+
+    runChunks();
+
+    std::unique_lock<std::mutex> lock(range->mutex);
+    range->done.wait(lock, [&range, chunkCount]() { return range->finishedChunks == chunkCount; });
+}
+
+unsigned int ThreadPool::defaultThreadCount()
+{
+    unsigned int count = std::thread::hardware_concurrency();
+    return count > 1 ? count - 1 : 1; // leave a core for the GL thread
+}
+
+ThreadPool &ThreadPool::shared()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::workerLoop()
+{
+    for (;;)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            taskAvailable.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty())
+                return;
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+
+        task();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--pending == 0)
+            allDone.notify_all();
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+    explicit ThreadPool(unsigned int threadCount = defaultThreadCount());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    void submit(std::function<void()> task);
+
+    // blocks until every submitted task has finished
+    void wait();
+
+    // Splits [0, count) into chunks of `grain` items and runs `body(begin, end)`
+    // on them. The calling thread works on chunks too and only waits for this
+    // range, so it is safe to call while other tasks are queued.
+    void parallelFor(std::size_t count, std::size_t grain,
+                     const std::function<void(std::size_t, std::size_t)> &body);
+
+    unsigned int size() const { return static_cast<unsigned int>(workers.size()); }
+
+    static unsigned int defaultThreadCount();
+
+    // process-wide pool for loading and per-frame jobs
+    static ThreadPool &shared();
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable taskAvailable;
+    std::condition_variable allDone;
+    std::size_t pending = 0;
+    bool stopping = false;
+
+    void workerLoop();
+};
+
+#endif
@@ -0,0 +1,38 @@
+// std140 blocks shared by the lit programs; mirrored by uniform_blocks.h,
+// so the array sizes are fixed here and not per permutation
+
+#define NR_LIGHTS 4
+#define NR_SPOTLIGHTS 2
+
+struct Light {
+    vec3 ambientLightColor;
+    float constant;
+    vec3 diffuseLightColor;
+    float linear;
+    vec3 specularLightColor;
+    float quadratic;
+    vec3 lightPosView;
+};
+
+struct SpotlightComponents {
+    vec3 spotDirectionView;
+    float cutOff;
+    float outerCutoff;
+};
+
+layout (std140) uniform FrameBlock {
+    mat4 view;
+    mat4 projection;
+    Light lights[NR_LIGHTS];
+    SpotlightComponents spotlightComponents[NR_SPOTLIGHTS];
+    vec3 fogColor;
+    float gamma;
+};
+
+layout (std140) uniform ObjectBlock {
+    mat4 model;
+    mat3 normViewModelMatrix;
+    vec4 lightDiffuseOverride[NR_LIGHTS]; // rgb replaces diffuseLightColor when a > 0
+    float shininess;
+    float fogDensity;
+};
@@ -0,0 +1,137 @@
+#ifndef UNIFORM_BLOCKS_H
+#define UNIFORM_BLOCKS_H
+#include <cstddef>
+#include <cstring>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "render_stats.h"
+
+// std140 mirrors of the uniform blocks shared by the lit shaders
+// (FrameBlock and ObjectBlock in the *_shader_*.glsl files)
+
+const int NR_LIGHTS = 4;
+const int NR_SPOTLIGHTS = 2;
+
+const GLuint FRAME_BLOCK_BINDING = 0;
+const GLuint OBJECT_BLOCK_BINDING = 1;
+const GLuint BEZIER_BLOCK_BINDING = 2;
+
+struct LightData
+{
+    glm::vec3 ambientLightColor;
+    float constant;
+    glm::vec3 diffuseLightColor;
+    float linear;
+    glm::vec3 specularLightColor;
+    float quadratic;
+    glm::vec3 lightPosView;
+    float padding;
+};
+
+struct SpotlightData
+{
+    glm::vec3 spotDirectionView;
+    float cutOff;
+    float outerCutoff;
+    float padding[3];
+};
+
+// written once per frame
+struct FrameBlock
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+    LightData lights[NR_LIGHTS];
+    SpotlightData spotlightComponents[NR_SPOTLIGHTS];
+    glm::vec3 fogColor;
+    float gamma;
+};
+
+// written once per drawn object
+struct ObjectBlock
+{
+    glm::mat4 model;
+    glm::vec4 normViewModelMatrix[3]; // std140 mat3: three vec4 columns
+    glm::vec4 lightDiffuseOverride[NR_LIGHTS]; // rgb replaces the light's diffuse color when a > 0
+    float shininess;
+    float fogDensity;
+    float padding[2];
+
+    void setNormalMatrix(const glm::mat3 &matrix)
+    {
+        for (int i = 0; i < 3; ++i)
+            normViewModelMatrix[i] = glm::vec4(matrix[i], 0.f);
+    }
+};
+
+// control heights of the bicubic Bezier surface (bezier_surface.glsl),
+// written once per frame
+struct BezierBlock
+{
+    glm::vec4 controlHeights[4]; // controlHeights[j][i]: i along u, j along v
+};
+
+static_assert(sizeof(LightData) == 64, "std140 Light stride");
+static_assert(sizeof(SpotlightData) == 32, "std140 SpotlightComponents stride");
+static_assert(offsetof(FrameBlock, lights) == 128 && offsetof(FrameBlock, spotlightComponents) == 384 &&
+              offsetof(FrameBlock, fogColor) == 448 && offsetof(FrameBlock, gamma) == 460,
+              "FrameBlock must match std140");
+static_assert(offsetof(ObjectBlock, normViewModelMatrix) == 64 && offsetof(ObjectBlock, lightDiffuseOverride) == 112 &&
+              offsetof(ObjectBlock, shininess) == 176 && offsetof(ObjectBlock, fogDensity) == 180,
+              "ObjectBlock must match std140");
+
+// A uniform buffer holding one T, attached to a fixed binding point.
+template <typename T>
+class UniformBuffer
+{
+public:
+    explicit UniformBuffer(GLuint binding)
+    {
+        glGenBuffers(1, &ID);
+        glBindBuffer(GL_UNIFORM_BUFFER, ID);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(T), nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, binding, ID);
+    }
+
+    UniformBuffer(const UniformBuffer &) = delete;
+    UniformBuffer &operator=(const UniformBuffer &) = delete;
+
+    // uploads only the span of 16-byte rows that differ from the last update
+    void update(const T &data)
+    {
+        std::size_t first = 0, last = sizeof(T);
+        if (shadowValid)
+        {
+            const unsigned char *previous = reinterpret_cast<const unsigned char *>(&shadow);
+            const unsigned char *next = reinterpret_cast<const unsigned char *>(&data);
+            while (first < sizeof(T) && std::memcmp(previous + first, next + first, ROW) == 0)
+                first += ROW;
+            while (last > first && std::memcmp(previous + last - ROW, next + last - ROW, ROW) == 0)
+                last -= ROW;
+        }
+
+        renderStats.blockBytesSkipped += sizeof(T) - (last - first);
+        if (first == last)
+            return;
+
+        glBindBuffer(GL_UNIFORM_BUFFER, ID);
+        glBufferSubData(GL_UNIFORM_BUFFER, first, last - first, reinterpret_cast<const unsigned char *>(&data) + first);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        renderStats.blockBytesUploaded += last - first;
+
+        shadow = data;
+        shadowValid = true;
+    }
+
+private:
+    static const std::size_t ROW = 16;
+    static_assert(sizeof(T) % ROW == 0, "std140 blocks are whole rows");
+
+    GLuint ID = 0;
+    T shadow;
+    bool shadowValid = false;
+};
+
+#endif
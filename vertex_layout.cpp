@@ -0,0 +1,142 @@
+#include "vertex_layout.h"
+#include "mesh.h"
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+static_assert(sizeof(Vertex) == 3 * sizeof(glm::vec3) + sizeof(glm::vec2) + sizeof(glm::vec3) +
+              MAX_BONE_INFLUENCE * (sizeof(int) + sizeof(float)), "Vertex must be tightly packed");
+
+namespace
+{
+    void write(unsigned char *dst, const void *src, std::size_t bytes)
+    {
+        std::memcpy(dst, src, bytes);
+    }
+
+    glm::uint packNormal(const glm::vec3 &n)
+    {
+        return glm::packSnorm3x10_1x2(glm::vec4(n, 0.f));
+    }
+}
+
+void VertexLayout::add(VertexSemantic semantic, GLint size, GLenum type, GLboolean normalized, bool integer, GLuint bytes)
+{
+    attributes.push_back({semantic, static_cast<GLuint>(semantic), size, type, normalized, integer, static_cast<GLuint>(stride)});
+    stride += bytes;
+}
+
+VertexLayout VertexLayout::make(VertexFormat format, bool skinned)
+{
+    VertexLayout layout;
+    layout.format = format;
+    layout.skinned = skinned;
+
+    if (format == VertexFormat::Full)
+    {
+        layout.add(VertexSemantic::Position, 3, GL_FLOAT, GL_FALSE, false, sizeof(glm::vec3));
+        layout.add(VertexSemantic::Normal, 3, GL_FLOAT, GL_FALSE, false, sizeof(glm::vec3));
+        layout.add(VertexSemantic::TexCoords, 2, GL_FLOAT, GL_FALSE, false, sizeof(glm::vec2));
+        layout.add(VertexSemantic::Tangent, 3, GL_FLOAT, GL_FALSE, false, sizeof(glm::vec3));
+        layout.add(VertexSemantic::Bitangent, 3, GL_FLOAT, GL_FALSE, false, sizeof(glm::vec3));
+        layout.add(VertexSemantic::BoneIDs, MAX_BONE_INFLUENCE, GL_INT, GL_FALSE, true, sizeof(int) * MAX_BONE_INFLUENCE);
+        layout.add(VertexSemantic::Weights, MAX_BONE_INFLUENCE, GL_FLOAT, GL_FALSE, false, sizeof(float) * MAX_BONE_INFLUENCE);
+        return layout;
+    }
+
+    layout.add(VertexSemantic::Position, 3, GL_FLOAT, GL_FALSE, false, sizeof(glm::vec3));
+    layout.add(VertexSemantic::Normal, 4, GL_INT_2_10_10_10_REV, GL_TRUE, false, 4);
+    layout.add(VertexSemantic::TexCoords, 2, GL_HALF_FLOAT, GL_FALSE, false, 4);
+    if (skinned)
+    {
+        layout.add(VertexSemantic::BoneIDs, MAX_BONE_INFLUENCE, GL_UNSIGNED_BYTE, GL_FALSE, true, MAX_BONE_INFLUENCE);
+        layout.add(VertexSemantic::Weights, MAX_BONE_INFLUENCE, GL_UNSIGNED_BYTE, GL_TRUE, false, MAX_BONE_INFLUENCE);
+    }
+    return layout;
+}
+
+void VertexLayout::pack(const std::vector<Vertex> &vertices, std::vector<unsigned char> &out) const
+{
+    pack(vertices.data(), vertices.size(), out);
+}
+
+void VertexLayout::pack(const Vertex *vertices, std::size_t count, std::vector<unsigned char> &out) const
+{
+    out.resize(count * stride);
+
+    if (format == VertexFormat::Full)
+    {
+        std::memcpy(out.data(), vertices, out.size());
+        return;
+    }
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const Vertex &vertex = vertices[i];
+        unsigned char *dst = out.data() + i * stride;
+
+        for (const VertexAttribute &attribute : attributes)
+        {
+            unsigned char *field = dst + attribute.offset;
+            switch (attribute.semantic)
+            {
+            case VertexSemantic::Position:
+                write(field, &vertex.Position, sizeof(glm::vec3));
+                break;
+            case VertexSemantic::Normal:
+            case VertexSemantic::Tangent:
+            case VertexSemantic::Bitangent:
+            {
+                const glm::vec3 &v = attribute.semantic == VertexSemantic::Normal ? vertex.Normal :
+                                     attribute.semantic == VertexSemantic::Tangent ? vertex.Tangent : vertex.Bitangent;
+                if (attribute.type == GL_FLOAT)
+                    write(field, &v, sizeof(glm::vec3));
+                else
+                {
+                    glm::uint packed = packNormal(v);
+                    write(field, &packed, sizeof(packed));
+                }
+                break;
+            }
+            case VertexSemantic::TexCoords:
+                if (attribute.type == GL_FLOAT)
+                    write(field, &vertex.TexCoords, sizeof(glm::vec2));
+                else
+                {
+                    glm::uint packed = glm::packHalf2x16(vertex.TexCoords);
+                    write(field, &packed, sizeof(packed));
+                }
+                break;
+            case VertexSemantic::BoneIDs:
+                if (attribute.type == GL_INT)
+                    write(field, vertex.m_BoneIDs, sizeof(vertex.m_BoneIDs));
+                else
+                    for (int b = 0; b < MAX_BONE_INFLUENCE; ++b)
+                        field[b] = static_cast<unsigned char>(std::clamp(vertex.m_BoneIDs[b], 0, 255));
+                break;
+            case VertexSemantic::Weights:
+                if (attribute.type == GL_FLOAT)
+                    write(field, vertex.m_Weights, sizeof(vertex.m_Weights));
+                else
+                    for (int b = 0; b < MAX_BONE_INFLUENCE; ++b)
+                        field[b] = static_cast<unsigned char>(std::clamp(vertex.m_Weights[b], 0.f, 1.f) * 255.f + 0.5f);
+                break;
+            }
+        }
+    }
+}
+
+void VertexLayout::apply(GLsizeiptr baseOffset) const
+{
+    for (const VertexAttribute &attribute : attributes)
+    {
+        const void *pointer = reinterpret_cast<const void *>(baseOffset + attribute.offset);
+        glEnableVertexAttribArray(attribute.location);
+        if (attribute.integer)
+            glVertexAttribIPointer(attribute.location, attribute.size, attribute.type, stride, pointer);
+        else
+            glVertexAttribPointer(attribute.location, attribute.size, attribute.type, attribute.normalized, stride, pointer);
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef VERTEX_LAYOUT_H
+#define VERTEX_LAYOUT_H
+#include <vector>
+#include <glad/glad.h>
+
+struct Vertex;
+
+enum class VertexFormat
+{
+    Full,   // every Vertex field as 32-bit floats/ints, 88 bytes
+    Compact // float position, 10_10_10_2 normal, half-float UV: 20 bytes
+};
+
+enum class VertexSemantic
+{
+    Position,
+    Normal,
+    TexCoords,
+    Tangent,
+    Bitangent,
+    BoneIDs,
+    Weights
+};
+
+struct VertexAttribute
+{
+    VertexSemantic semantic;
+    GLuint location;
+    GLint size;
+    GLenum type;
+    GLboolean normalized;
+    bool integer; // uses glVertexAttribIPointer
+    GLuint offset;
+};
+
+// Describes how Vertex data is laid out in a vertex buffer. Attribute
+// locations match the shaders: 0 position, 1 normal, 2 UV, 3 tangent,
+// 4 bitangent, 5 bone IDs, 6 bone weights.
+class VertexLayout
+{
+public:
+    VertexFormat format = VertexFormat::Full;
+    bool skinned = false;
+    GLsizei stride = 0;
+    std::vector<VertexAttribute> attributes;
+
+    // bone attributes are only added for skinned meshes
+    static VertexLayout make(VertexFormat format, bool skinned);
+
+    void pack(const std::vector<Vertex> &vertices, std::vector<unsigned char> &out) const;
+    void pack(const Vertex *vertices, std::size_t count, std::vector<unsigned char> &out) const;
+
+    // sets up the attribute pointers of the bound VAO for the bound VBO,
+    // starting `baseOffset` bytes into it
+    void apply(GLsizeiptr baseOffset = 0) const;
+
+private:
+    void add(VertexSemantic semantic, GLint size, GLenum type, GLboolean normalized, bool integer, GLuint bytes);
+};
+
+#endif